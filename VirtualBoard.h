@@ -33,14 +33,54 @@
 
 bool _repeatMainLoop = true;
 
-#if defined(VB_FIRMATA_PORT)
+#if defined(VB_FIRMATA_REPLAY)
+// Plays back a log of VB_FIRMATA_RECORD, as fast as possible unless VB_FIRMATA_REPLAY_TIMING is defined
+CFI_StreamReplayer _vbFirmataReplayer;
+#elif defined(VB_FIRMATA_SIMULATOR)
+// VB_FIRMATA_SIMULATOR is the simulated baud rate, 0 runs the link at full speed
+CFI_BoardSimulator _vbBoardSimulator;
+#elif defined(VB_FIRMATA_HOST)
+#if !defined(VB_FIRMATA_TCP_PORT)
+#define VB_FIRMATA_TCP_PORT (3030) // default port of StandardFirmataEthernet
+#endif
+SocketClient _vbFirmataClient;
+#if defined(VB_FIRMATA_UDP_PORT)
+SocketUDP _vbFirmataReports;
+#endif
+#elif defined(VB_FIRMATA_PORT)
 HardwareSerial _vbHardwareSerial(VB_FIRMATA_PORT);
 #endif
 
+#if defined(VB_FIRMATA_PORT) && defined(VB_FIRMATA_RECORD)
+// Logs the traffic of the first board to the file VB_FIRMATA_RECORD
+CFI_StreamRecorder _vbFirmataRecorder;
+#endif
+
 #if !defined(VB_FIRMATA_BAUD_RATE)
 #define VB_FIRMATA_BAUD_RATE (115200)
 #endif
 
+// VB_FIRMATA_STATISTICS is the interval in ms of the round trip probes of the
+// first board, 0 = none. The link statistics are printed when the sketch ends.
+
+// Further boards, e.g. VB_FIRMATA_PORT2 "COM4" with VB_FIRMATA_FIRST_PIN2 (64)
+// makes pin 13 of that board pin 77 of the sketch
+#if defined(VB_FIRMATA_PORT) && defined(VB_FIRMATA_PORT2)
+#if !defined(VB_FIRMATA_FIRST_PIN2)
+#define VB_FIRMATA_FIRST_PIN2 (64)
+#endif
+HardwareSerial _vbHardwareSerial2(VB_FIRMATA_PORT2);
+#endif
+#if defined(VB_FIRMATA_PORT) && defined(VB_FIRMATA_PORT3)
+#if !defined(VB_FIRMATA_FIRST_PIN3)
+#define VB_FIRMATA_FIRST_PIN3 (128)
+#endif
+HardwareSerial _vbHardwareSerial3(VB_FIRMATA_PORT3);
+#endif
+#if !defined(VB_FIRMATA_BOARD_PINS)
+#define VB_FIRMATA_BOARD_PINS (64) // pins reserved for each further board
+#endif
+
 // see:
 // https://docs.microsoft.com/en-us/windows/console/registering-a-control-handler-function
 //
@@ -96,7 +136,37 @@ int main(int argc, char *argv[])
     return 1;
   }
 
-#if defined(VB_FIRMATA_PORT)
+#if defined(VB_FIRMATA_REPLAY)
+  // Start Firmata client with a recorded session
+#if defined(VB_FIRMATA_REPLAY_TIMING)
+  bool recordedTiming = true;
+#else
+  bool recordedTiming = false;
+#endif
+  if (!_vbFirmataReplayer.begin(VB_FIRMATA_REPLAY, recordedTiming)) {
+    printf("\nERROR: Could not replay %s", VB_FIRMATA_REPLAY);
+    return 1;
+  }
+  Stream& firmataStream = _vbFirmataReplayer;
+#elif defined(VB_FIRMATA_SIMULATOR)
+  // Start Firmata client with a simulated board, no hardware needed
+  _vbBoardSimulator.begin(VB_FIRMATA_SIMULATOR);
+  GPIO.ClientFirmata.setLinkBaudRate(VB_FIRMATA_SIMULATOR);
+  Stream& firmataStream = _vbBoardSimulator;
+#elif defined(VB_FIRMATA_HOST)
+  // Start Firmata client with network stream, reconnects itself when the link is lost
+  if (!_vbFirmataClient.connect(VB_FIRMATA_HOST, VB_FIRMATA_TCP_PORT)) {
+    printf("\nERROR: Could not connect to Firmata host %s:%d", VB_FIRMATA_HOST, VB_FIRMATA_TCP_PORT);
+    return 1;
+  }
+  Stream& firmataStream = _vbFirmataClient;
+#if defined(VB_FIRMATA_UDP_PORT)
+  // Reports of the board as datagrams to this local port
+  if (_vbFirmataReports.begin(VB_FIRMATA_UDP_PORT)) {
+    GPIO.ClientFirmata.beginReports(_vbFirmataReports);
+  }
+#endif
+#elif defined(VB_FIRMATA_PORT)
   // Start Firmata client with serial stream
   _vbHardwareSerial.begin(VB_FIRMATA_BAUD_RATE);
   _vbHardwareSerial.setTimeout(0);
@@ -104,7 +174,8 @@ int main(int argc, char *argv[])
   // Wait for AVR reboot time while serial connect
   Sleep(2000);
 #endif
-  GPIO.ClientFirmata.begin(_vbHardwareSerial);
+  GPIO.ClientFirmata.setLinkBaudRate(VB_FIRMATA_BAUD_RATE);
+  Stream& firmataStream = _vbHardwareSerial;
 #elif defined(VM_USE_HARDWARE)
 #if defined(VM_HW_SERIAL_NUMBER)
   gpioWrapper.begin(VM_HW_SERIAL_NUMBER);
@@ -113,6 +184,48 @@ int main(int argc, char *argv[])
 #endif
 #endif // defined(VB_FIRMATA_PORT)
 
+#if defined(VB_FIRMATA_PORT)
+#if defined(VB_FIRMATA_RECORD)
+  if (!_vbFirmataRecorder.begin(firmataStream, VB_FIRMATA_RECORD)) {
+    printf("\nERROR: Could not record to %s", VB_FIRMATA_RECORD);
+    return 1;
+  }
+  GPIO.ClientFirmata.begin(_vbFirmataRecorder);
+#else
+  GPIO.ClientFirmata.begin(firmataStream);
+#endif
+#if defined(VB_FIRMATA_STATISTICS)
+  GPIO.ClientFirmata.setProbeInterval(VB_FIRMATA_STATISTICS);
+#endif
+#if defined(VB_INTERRUPT_THREAD)
+  GPIO.beginInterruptThread();
+#endif
+#endif
+
+#if defined(VB_FIRMATA_PORT) && defined(VB_FIRMATA_PORT2)
+  _vbHardwareSerial2.begin(VB_FIRMATA_BAUD_RATE);
+  _vbHardwareSerial2.setTimeout(0);
+#endif
+#if defined(VB_FIRMATA_PORT) && defined(VB_FIRMATA_PORT3)
+  _vbHardwareSerial3.begin(VB_FIRMATA_BAUD_RATE);
+  _vbHardwareSerial3.setTimeout(0);
+#endif
+#if defined(VB_FIRMATA_PORT) && (defined(VB_FIRMATA_PORT2) || defined(VB_FIRMATA_PORT3)) && defined(ARDUINO_ARCH_AVR)
+  Sleep(2000);
+#endif
+#if defined(VB_FIRMATA_PORT) && defined(VB_FIRMATA_PORT2)
+  if (!GPIO.addBoard(_vbHardwareSerial2, VB_FIRMATA_FIRST_PIN2, VB_FIRMATA_BOARD_PINS)) {
+    printf("\nERROR: Could not add Firmata board at %s", VB_FIRMATA_PORT2);
+    return 1;
+  }
+#endif
+#if defined(VB_FIRMATA_PORT) && defined(VB_FIRMATA_PORT3)
+  if (!GPIO.addBoard(_vbHardwareSerial3, VB_FIRMATA_FIRST_PIN3, VB_FIRMATA_BOARD_PINS)) {
+    printf("\nERROR: Could not add Firmata board at %s", VB_FIRMATA_PORT3);
+    return 1;
+  }
+#endif
+
   setup(); // Call sketch setup
 
   while (_repeatMainLoop) {
@@ -120,6 +233,21 @@ int main(int argc, char *argv[])
     loop(); // Call sketch loop
   }
 
+#if defined(VB_FIRMATA_PORT) && defined(VB_INTERRUPT_THREAD)
+  GPIO.endInterruptThread();
+#endif
+#if defined(VB_FIRMATA_PORT)
+  GPIO.endBoards();
+#endif
+#if defined(VB_FIRMATA_PORT) && defined(VB_FIRMATA_STATISTICS)
+  GPIO.ClientFirmata.printStatistics(Serial);
+#endif
+#if defined(VB_FIRMATA_PORT) && defined(VB_FIRMATA_RECORD)
+  _vbFirmataRecorder.end();
+#endif
+#if defined(VB_FIRMATA_HOST) && !defined(VB_FIRMATA_SIMULATOR) && !defined(VB_FIRMATA_REPLAY)
+  _vbFirmataClient.stop();
+#endif
 #if defined(VM_USE_HARDWARE)
   gpioWrapper.end();
 #endif
@@ -32,6 +32,17 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
+// A network board uses the same Firmata client and features as a serial one
+#if defined(VB_FIRMATA_HOST) && !defined(VB_FIRMATA_PORT)
+#define VB_FIRMATA_PORT VB_FIRMATA_HOST
+#endif
+#if defined(VB_FIRMATA_REPLAY) && !defined(VB_FIRMATA_PORT)
+#define VB_FIRMATA_PORT VB_FIRMATA_REPLAY
+#endif
+#if defined(VB_FIRMATA_SIMULATOR) && !defined(VB_FIRMATA_PORT)
+#define VB_FIRMATA_PORT "SIMULATOR"
+#endif
+
 // Additional includes for the Visual C++ compiler
 
 #include "cores/arduino/Arduino.h"
@@ -52,8 +63,13 @@
 #include "cores/arduino/Stream.cpp"
 #include "cores/arduino/IPAddress.cpp"
 #include "cores/arduino/HardwareSerial.cpp"
+#include "cores/arduino/SocketClient.cpp"
+#include "cores/arduino/SocketUDP.cpp"
 #include "cores/arduino/serial/serial.cc"
 #include "cores/arduino/serial/win.cc"
+// unix.cc builds the serial library where _WIN32 is not defined; the rest of
+// VirtualBoard (windows.h, console, WinSock, IO-Warrior) is still Win32 only
+#include "cores/arduino/serial/unix.cc"
 #include "cores/arduino/StreamString.cpp"
 #include "cores/arduino/clientfirmata/CFI_ClientFirmataIncludes.h"
 
@@ -63,6 +63,33 @@ void analogWrite(uint8_t pin, uint16_t value)
   GPIO._analogWrite(pin, value);
 }
 
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+{
+  GPIO._shiftOut(dataPin, clockPin, bitOrder, &val, 1);
+}
+
+// Shifting a whole buffer costs one message instead of one per byte
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t* buf, size_t len)
+{
+  GPIO._shiftOut(dataPin, clockPin, bitOrder, buf, len);
+}
+
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder)
+{
+  return GPIO._shiftIn(dataPin, clockPin, bitOrder);
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout)
+{
+  return GPIO._pulseIn(pin, state, timeout);
+}
+
+// Same as pulseIn(), both are based on timestamps instead of counted loops
+unsigned long pulseInLong(uint8_t pin, uint8_t state, unsigned long timeout)
+{
+  return GPIO._pulseIn(pin, state, timeout);
+}
+
 void yield(void)
 {
   _yield();
@@ -100,6 +100,16 @@ uint8_t digitalRead(uint8_t pin);
 uint16_t analogRead(uint8_t pin);
 void analogWrite(uint8_t pin, uint16_t value);
 
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t* buf, size_t len);
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
+unsigned long pulseInLong(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
+
 #define NOT_AN_INTERRUPT -1
 
 void delay(unsigned int millisec);
@@ -23,6 +23,7 @@
  */
 
 #include "GPIO.h"
+#include "utils/log.h"
 
 GPIOWrapper gpioWrapper;
 
@@ -32,10 +33,8 @@ GPIOClass GPIO = GPIOClass();
 GPIOClass::GPIOClass()
 {
 #if defined(VB_FIRMATA_PORT)
-	_digitalInput = new CFI_DigitalInputFeature(ClientFirmata);
-	_digitalOutput = new CFI_DigitalOutputFeature(ClientFirmata);
-	_analogInput = new CFI_AnalogInputFeature(ClientFirmata);
-	_analogOutput = new CFI_AnalogOutputFeature(ClientFirmata);
+	_boards[0] = { &ClientFirmata, NULL, NULL, NULL, NULL, 0, NULL, NULL };
+	_boardsRunning = false;
 #endif
 }
 
@@ -50,14 +49,20 @@ GPIOClass::~GPIOClass()
 void GPIOClass::_pinMode(uint8_t pin, uint8_t mode)
 {
 #if defined(VB_FIRMATA_PORT)
+  board_t& board = _boards[_pinBoard[pin]];
+  BoardLock lock(board);
+  pin -= board.firstPin;
   switch (mode) {
   case INPUT:
-      _digitalInput->setPinMode(pin, CFI_PIN_MODE_INPUT);
+      digitalInput(board)->setPinMode(pin, CFI_PIN_MODE_INPUT);
   case INPUT_PULLUP:
-      _digitalInput->setPinMode(pin, CFI_PIN_MODE_PULLUP);
+      digitalInput(board)->setPinMode(pin, CFI_PIN_MODE_PULLUP);
       break;
   case OUTPUT:
-      _digitalOutput->setPinMode(pin, CFI_PIN_MODE_OUTPUT);
+      if (board.digitalInput != NULL) {
+          digitalInput(board)->releasePin(pin);
+      }
+      digitalOutput(board)->setPinMode(pin, CFI_PIN_MODE_OUTPUT);
   default:
       break;
   }
@@ -69,7 +74,9 @@ void GPIOClass::_pinMode(uint8_t pin, uint8_t mode)
 void GPIOClass::_digitalWrite(uint8_t pin, uint8_t value)
 {
 #if defined(VB_FIRMATA_PORT)
-  _digitalOutput->setPinValue(pin, value != 0);
+  board_t& board = _boards[_pinBoard[pin]];
+  BoardLock lock(board);
+  digitalOutput(board)->setPinValue(pin - board.firstPin, value != 0);
 #elif defined(VM_USE_HARDWARE)
   gpioWrapper.digitalWrite(pin, value != 0);
 #endif
@@ -78,7 +85,12 @@ void GPIOClass::_digitalWrite(uint8_t pin, uint8_t value)
 void GPIOClass::_digitalWritePort(uint8_t port, uint8_t value)
 {
 #if defined(VB_FIRMATA_PORT)
-  _digitalOutput->digitalWritePort(port, value);
+  if (port >= sizeof(_pinBoard) / 8) {
+    return;
+  }
+  board_t& board = _boards[_pinBoard[port << 3]];
+  BoardLock lock(board);
+  digitalOutput(board)->digitalWritePort(port - (board.firstPin >> 3), value);
 #elif defined(VM_USE_HARDWARE)
   gpioWrapper.digitalWritePort(port, value);
 #endif
@@ -87,7 +99,9 @@ void GPIOClass::_digitalWritePort(uint8_t port, uint8_t value)
 uint8_t GPIOClass::_digitalRead(uint8_t pin)
 {
 #if defined(VB_FIRMATA_PORT)
-  return _digitalInput->getPinValue(pin);
+  board_t& board = _boards[_pinBoard[pin]];
+  BoardLock lock(board);
+  return digitalInput(board)->getPinValue(pin - board.firstPin);
 #elif defined(VM_USE_HARDWARE)
   return gpioWrapper.digitalRead(pin);
 #else
@@ -95,11 +109,135 @@ uint8_t GPIOClass::_digitalRead(uint8_t pin)
 #endif
 }
 
+void GPIOClass::_shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t* values, size_t count)
+{
+#if defined(VB_FIRMATA_PORT)
+  board_t& board = _boards[_pinBoard[dataPin]];
+  if (_pinBoard[clockPin] != _pinBoard[dataPin]) {
+    // one board can't clock the data pin of another
+    return;
+  }
+  if (_pinBoard[dataPin] == 0 && shift()->isSupported(dataPin, clockPin)) {
+    shift()->shiftOut(dataPin, clockPin, bitOrder, values, count);
+  }
+  else {
+    BoardLock lock(board);
+    digitalOutput(board)->shiftOut(dataPin - board.firstPin, clockPin - board.firstPin, bitOrder, values, count);
+  }
+#else
+  for (size_t n = 0; n < count; n++) {
+    for (uint8_t i = 0; i < 8; i++) {
+      if (bitOrder == LSBFIRST) {
+        _digitalWrite(dataPin, (values[n] >> i) & 0x01);
+      }
+      else {
+        _digitalWrite(dataPin, (values[n] >> (7 - i)) & 0x01);
+      }
+      _digitalWrite(clockPin, HIGH);
+      _digitalWrite(clockPin, LOW);
+    }
+  }
+#endif
+}
+
+uint8_t GPIOClass::_shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder)
+{
+  uint8_t value = 0;
+#if defined(VB_FIRMATA_PORT)
+  if (_pinBoard[dataPin] == 0 && _pinBoard[clockPin] == 0 &&
+      shift()->isSupported(dataPin, clockPin) &&
+      shift()->shiftIn(dataPin, clockPin, bitOrder, &value, 1)) {
+    return value;
+  }
+  // Bit-banging would read the port report of the board, which arrives
+  // long after the clock edge, so every bit would see the same stale level
+  logError("shiftIn: pins %d, %d need the shift feature of the main board\n", dataPin, clockPin);
+  return 0;
+#else
+  for (uint8_t i = 0; i < 8; i++) {
+    _digitalWrite(clockPin, HIGH);
+    if (bitOrder == LSBFIRST) {
+      value |= _digitalRead(dataPin) << i;
+    }
+    else {
+      value |= _digitalRead(dataPin) << (7 - i);
+    }
+    _digitalWrite(clockPin, LOW);
+  }
+  return value;
+#endif
+}
+
+unsigned long GPIOClass::_pulseIn(uint8_t pin, uint8_t state, unsigned long timeout)
+{
+#if defined(VB_FIRMATA_PORT)
+  board_t& board = _boards[_pinBoard[pin]];
+  if (board.mutex == NULL) {
+    return digitalInput(board)->pulseIn(pin, state, timeout);
+  }
+  // The I/O thread of an added board decodes the port messages of the
+  // pulse, so the board is locked only to look at the measurement
+  {
+    BoardLock lock(board);
+    digitalInput(board)->beginPulse(pin - board.firstPin, state);
+  }
+  unsigned long startMicros = micros();
+  while (true) {
+    {
+      BoardLock lock(board);
+      if (digitalInput(board)->pulseDone()) {
+        break;
+      }
+    }
+    unsigned long elapsed = micros() - startMicros;
+    if (elapsed >= timeout) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(min(timeout - elapsed, 1000UL)));
+  }
+  BoardLock lock(board);
+  return digitalInput(board)->endPulse();
+#else
+  unsigned long startMicros = micros();
+  while (_digitalRead(pin) == state) {
+    if (micros() - startMicros >= timeout) {
+      return 0;
+    }
+  }
+  while (_digitalRead(pin) != state) {
+    if (micros() - startMicros >= timeout) {
+      return 0;
+    }
+  }
+  unsigned long pulseStart = micros();
+  while (_digitalRead(pin) == state) {
+    if (micros() - startMicros >= timeout) {
+      return 0;
+    }
+  }
+  return micros() - pulseStart;
+#endif
+}
+
+unsigned long GPIOClass::pingRead(uint8_t pin, uint8_t state, unsigned long triggerMicros, unsigned long timeout)
+{
+#if defined(VB_FIRMATA_PORT)
+  if (_ping == NULL) {
+    _ping = new CFI_PingFeature(ClientFirmata);
+  }
+  return _ping->pingRead(pin, state, triggerMicros, timeout);
+#else
+  return 0;
+#endif
+}
+
 uint16_t GPIOClass::_analogRead(uint8_t pin)
 {
 #if defined(VB_FIRMATA_PORT)
-  uint8_t firmataPin = pin - A0;
-  return _analogInput->getPinValue(firmataPin);
+  board_t& board = _boards[_pinBoard[pin]];
+  BoardLock lock(board);
+  uint8_t firmataPin = pin - board.firstPin - A0;
+  return analogInput(board)->getPinValue(firmataPin);
 #elif defined(VM_USE_HARDWARE)
   uint8_t firmataPin = pin - A0;
   return gpioWrapper.analogRead(firmataPin);
@@ -111,7 +249,9 @@ uint16_t GPIOClass::_analogRead(uint8_t pin)
 void GPIOClass::_analogWrite(uint8_t pin, uint16_t value)
 {
 #if defined(VB_FIRMATA_PORT)
-  _analogOutput->setPinValue(pin, value);
+  board_t& board = _boards[_pinBoard[pin]];
+  BoardLock lock(board);
+  analogOutput(board)->setPinValue(pin - board.firstPin, value);
 #elif defined(VM_USE_HARDWARE)
   gpioWrapper.analogWrite(pin, value);
 #endif
@@ -120,31 +260,349 @@ void GPIOClass::_analogWrite(uint8_t pin, uint16_t value)
 void GPIOClass::attachInterrupt(uint8_t interruptNum, void(*userFunc)(void), int mode)
 {
 #if defined(VB_FIRMATA_PORT)
-    _digitalInput->attachInterrupt(interruptNum, userFunc, mode);
+    digitalInput(_boards[0])->attachInterrupt(interruptNum, userFunc, mode);
 #endif
 }
 
 void GPIOClass::detachInterrupt(uint8_t interruptNum)
 {
 #if defined(VB_FIRMATA_PORT)
-    _digitalInput->detachInterrupt(interruptNum);
+    digitalInput(_boards[0])->detachInterrupt(interruptNum);
+#endif
+}
+
+uint32_t GPIOClass::missedInterrupts(uint8_t interruptNum)
+{
+#if defined(VB_FIRMATA_PORT)
+    return digitalInput(_boards[0])->missedInterrupts(interruptNum);
+#else
+    return 0;
+#endif
+}
+
+unsigned long GPIOClass::interruptMicros()
+{
+#if defined(VB_FIRMATA_PORT)
+    return digitalInput(_boards[0])->interruptMicros();
+#else
+    return 0;
+#endif
+}
+
+void GPIOClass::beginInterruptThread()
+{
+#if defined(VB_FIRMATA_PORT)
+    _interruptThread = true;
+    if (_boards[0].digitalInput != NULL) {
+        _boards[0].digitalInput->beginInterruptThread();
+    }
+#endif
+}
+
+void GPIOClass::endInterruptThread()
+{
+#if defined(VB_FIRMATA_PORT)
+    _interruptThread = false;
+    if (_boards[0].digitalInput != NULL) {
+        _boards[0].digitalInput->endInterruptThread();
+    }
+#endif
+}
+
+uint32_t GPIOClass::interruptLatency(uint8_t bucket)
+{
+#if defined(VB_FIRMATA_PORT)
+    return digitalInput(_boards[0])->interruptLatency(bucket);
+#else
+    return 0;
+#endif
+}
+
+unsigned long GPIOClass::interruptLatencyPercentile(uint8_t percent)
+{
+#if defined(VB_FIRMATA_PORT)
+    return digitalInput(_boards[0])->interruptLatencyPercentile(percent);
+#else
+    return 0;
+#endif
+}
+
+void GPIOClass::resetInterruptLatency()
+{
+#if defined(VB_FIRMATA_PORT)
+    digitalInput(_boards[0])->resetInterruptLatency();
+#endif
+}
+
+void GPIOClass::attachAnalogInterrupt(uint8_t pin, int threshold, int hysteresis, int mode, void(*userFunc)(void))
+{
+#if defined(VB_FIRMATA_PORT)
+    board_t& board = _boards[_pinBoard[pin]];
+    BoardLock lock(board);
+    analogInput(board)->attachInterrupt(pin - board.firstPin - A0, threshold, hysteresis, mode, userFunc);
+#endif
+}
+
+void GPIOClass::detachAnalogInterrupt(uint8_t pin)
+{
+#if defined(VB_FIRMATA_PORT)
+    board_t& board = _boards[_pinBoard[pin]];
+    BoardLock lock(board);
+    analogInput(board)->detachInterrupt(pin - board.firstPin - A0);
 #endif
 }
 
 void GPIOClass::interrupts()
 {
 #if defined(VB_FIRMATA_PORT)
-    _digitalInput->interrupts();
+    _interruptsEnabled = true;
+    for (uint8_t i = 0; i < _boardCount; i++) {
+        BoardLock lock(_boards[i]);
+        if (_boards[i].digitalInput != NULL) {
+            _boards[i].digitalInput->interrupts();
+        }
+        if (_boards[i].analogInput != NULL) {
+            _boards[i].analogInput->interrupts();
+        }
+    }
 #endif
 }
 
 void GPIOClass::noInterrupts()
 {
 #if defined(VB_FIRMATA_PORT)
-    _digitalInput->noInterrupts();
+    _interruptsEnabled = false;
+    for (uint8_t i = 0; i < _boardCount; i++) {
+        BoardLock lock(_boards[i]);
+        if (_boards[i].digitalInput != NULL) {
+            _boards[i].digitalInput->noInterrupts();
+        }
+        if (_boards[i].analogInput != NULL) {
+            _boards[i].analogInput->noInterrupts();
+        }
+    }
+#endif
+}
+
+void GPIOClass::setReportIdleTimeout(unsigned long timeout)
+{
+#if defined(VB_FIRMATA_PORT)
+    _reportIdleTimeout = timeout;
+    for (uint8_t i = 0; i < _boardCount; i++) {
+        BoardLock lock(_boards[i]);
+        if (_boards[i].digitalInput != NULL) {
+            _boards[i].digitalInput->setReportIdleTimeout(timeout);
+        }
+        if (_boards[i].analogInput != NULL) {
+            _boards[i].analogInput->setReportIdleTimeout(timeout);
+        }
+    }
+#endif
+}
+
+void GPIOClass::setDebounce(uint8_t pin, uint8_t mode, uint16_t time)
+{
+#if defined(VB_FIRMATA_PORT)
+    board_t& board = _boards[_pinBoard[pin]];
+    BoardLock lock(board);
+    digitalInput(board)->setDebounce(pin - board.firstPin, mode, time);
+#endif
+}
+
+void GPIOClass::setSamplingInterval(unsigned int interval)
+{
+#if defined(VB_FIRMATA_PORT)
+    analogInput(_boards[0])->setSamplingInterval(interval);
+#endif
+}
+
+void GPIOClass::setAdaptiveSampling(unsigned int minInterval, unsigned int maxInterval)
+{
+#if defined(VB_FIRMATA_PORT)
+    analogInput(_boards[0])->setAdaptiveSampling(minInterval, maxInterval);
+#endif
+}
+
+bool GPIOClass::beginAnalogCapture(uint8_t pin, size_t capacity)
+{
+#if defined(VB_FIRMATA_PORT)
+    return analogInput(_boards[0])->beginCapture(pin - A0, capacity);
+#else
+    return false;
+#endif
+}
+
+void GPIOClass::endAnalogCapture(uint8_t pin)
+{
+#if defined(VB_FIRMATA_PORT)
+    analogInput(_boards[0])->endCapture(pin - A0);
+#endif
+}
+
+size_t GPIOClass::analogCaptureAvailable(uint8_t pin)
+{
+#if defined(VB_FIRMATA_PORT)
+    return analogInput(_boards[0])->capturedSamples(pin - A0);
+#else
+    return 0;
+#endif
+}
+
+size_t GPIOClass::readAnalogCapture(uint8_t pin, CFI_AnalogSample* samples, size_t count)
+{
+#if defined(VB_FIRMATA_PORT)
+    return analogInput(_boards[0])->readSamples(pin - A0, samples, count);
+#else
+    return 0;
+#endif
+}
+
+uint32_t GPIOClass::analogCaptureDropped(uint8_t pin)
+{
+#if defined(VB_FIRMATA_PORT)
+    return analogInput(_boards[0])->droppedSamples(pin - A0);
+#else
+    return 0;
+#endif
+}
+
+bool GPIOClass::beginAnalogExport(uint8_t pin, const char* fileName, uint8_t format)
+{
+#if defined(VB_FIRMATA_PORT)
+    return analogInput(_boards[0])->beginExport(pin - A0, fileName, format);
+#else
+    return false;
 #endif
 }
 
+void GPIOClass::endAnalogExport(uint8_t pin)
+{
+#if defined(VB_FIRMATA_PORT)
+    analogInput(_boards[0])->endExport(pin - A0);
+#endif
+}
+
+#if defined(VB_FIRMATA_PORT)
+bool GPIOClass::addBoard(Stream& stream, uint8_t firstPin, uint8_t pinCount)
+{
+    if (_boardCount == VB_FIRMATA_MAX_BOARDS || (firstPin & 0x07) != 0 || firstPin + pinCount > 256) {
+        return false;
+    }
+    // the pins of the first board are not in the table, it owns every free entry
+    if (firstPin < NUM_DIGITAL_PINS) {
+        return false;
+    }
+    for (int pin = firstPin; pin < firstPin + pinCount; pin++) {
+        if (_pinBoard[pin] != 0) {
+            return false;
+        }
+    }
+
+    board_t& board = _boards[_boardCount];
+    board.firmata = new CFI_ClientFirmata();
+    board.digitalInput = NULL;
+    board.digitalOutput = NULL;
+    board.analogInput = NULL;
+    board.analogOutput = NULL;
+    board.firstPin = firstPin;
+    board.mutex = new std::recursive_mutex();
+    board.firmata->begin(stream);
+
+    // the table switches only after the board is complete
+    for (int pin = firstPin; pin < firstPin + pinCount; pin++) {
+        _pinBoard[pin] = _boardCount;
+    }
+    _boardCount++;
+
+    _boardsRunning = true;
+    board.ioThread = new std::thread(&GPIOClass::boardThread, this, &board);
+    return true;
+}
+
+void GPIOClass::endBoards()
+{
+    _boardsRunning = false;
+    for (uint8_t i = 1; i < _boardCount; i++) {
+        if (_boards[i].ioThread != NULL) {
+            _boards[i].ioThread->join();
+            delete _boards[i].ioThread;
+            _boards[i].ioThread = NULL;
+        }
+    }
+}
+
+// Decodes the input of an added board while the sketch runs, pin accesses
+// of the sketch wait for the lock only during one update().
+void GPIOClass::boardThread(board_t* board)
+{
+    while (_boardsRunning) {
+        bool pending;
+        {
+            BoardLock lock(*board);
+            board->firmata->update();
+            pending = board->firmata->available() > 0;
+        }
+        if (!pending) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+// The features of a board are created on first use, so a sketch pays neither
+// memory nor update() time for the ones it never touches. Called with the
+// board locked.
+CFI_DigitalInputFeature* GPIOClass::digitalInput(board_t& board)
+{
+    if (board.digitalInput == NULL) {
+        board.digitalInput = new CFI_DigitalInputFeature(*board.firmata);
+        board.digitalInput->setReportIdleTimeout(_reportIdleTimeout);
+        if (_interruptThread && &board == &_boards[0]) {
+            board.digitalInput->beginInterruptThread();
+        }
+        if (!_interruptsEnabled) {
+            board.digitalInput->noInterrupts();
+        }
+    }
+    return board.digitalInput;
+}
+
+CFI_DigitalOutputFeature* GPIOClass::digitalOutput(board_t& board)
+{
+    if (board.digitalOutput == NULL) {
+        board.digitalOutput = new CFI_DigitalOutputFeature(*board.firmata);
+    }
+    return board.digitalOutput;
+}
+
+CFI_AnalogInputFeature* GPIOClass::analogInput(board_t& board)
+{
+    if (board.analogInput == NULL) {
+        board.analogInput = new CFI_AnalogInputFeature(*board.firmata);
+        board.analogInput->setReportIdleTimeout(_reportIdleTimeout);
+        if (!_interruptsEnabled) {
+            board.analogInput->noInterrupts();
+        }
+    }
+    return board.analogInput;
+}
+
+CFI_AnalogOutputFeature* GPIOClass::analogOutput(board_t& board)
+{
+    if (board.analogOutput == NULL) {
+        board.analogOutput = new CFI_AnalogOutputFeature(*board.firmata);
+    }
+    return board.analogOutput;
+}
+
+CFI_ShiftFeature* GPIOClass::shift()
+{
+    if (_shift == NULL) {
+        _shift = new CFI_ShiftFeature(ClientFirmata);
+    }
+    return _shift;
+}
+#endif
+
 GPIOClass& GPIOClass::operator=(const GPIOClass& other)
 {
   if (this != &other) {
@@ -34,6 +34,20 @@
 #define LOW 0
 #define HIGH 1
 
+#define DEBOUNCE_NONE 0
+#define DEBOUNCE_TIME 1
+#define DEBOUNCE_INTEGRATOR 2
+
+#if !defined(VB_FIRMATA_MAX_BOARDS)
+#define VB_FIRMATA_MAX_BOARDS 4
+#endif
+
+#if defined(VB_FIRMATA_PORT)
+#include <atomic>
+#include <mutex>
+#include <thread>
+#endif
+
 /**
  * @brief GPIO class
  */
@@ -84,6 +98,37 @@ public:
      */
     uint8_t _digitalRead(uint8_t pin);
     /**
+    * @brief Shifts the bytes out, one message per buffer if the board supports
+    * shift mode, otherwise bit-banged with combined port messages.
+    *
+    * @param dataPin The pin on which to output each bit.
+    * @param clockPin The pin to toggle once the dataPin has been set to the correct value.
+    * @param bitOrder MSBFIRST or LSBFIRST.
+    */
+    void _shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t* values, size_t count);
+    /**
+    * @brief Shifts a byte in, one round-trip if the board supports shift mode.
+    * Without it an error is logged and 0 returned, port reports are too late
+    * for bit-banging.
+    */
+    uint8_t _shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
+    /**
+    * @brief Measures a pulse on the pin from the timestamped port messages.
+    *
+    * @param state HIGH or LOW, the level of the pulse.
+    * @param timeout in microseconds.
+    * @return the length of the pulse in microseconds or 0 on timeout.
+    */
+    unsigned long _pulseIn(uint8_t pin, uint8_t state, unsigned long timeout);
+    /**
+    * @brief Triggers an ultrasonic sensor and measures the echo on the board,
+    * needs a firmware with PingFirmata.
+    *
+    * @param triggerMicros length of the trigger pulse, the pin is used for both.
+    * @return the length of the echo pulse in microseconds or 0 on timeout.
+    */
+    unsigned long pingRead(uint8_t pin, uint8_t state, unsigned long triggerMicros, unsigned long timeout);
+    /**
     * @brief Reads the analog value from a specified analog pin.
     *
     * @param pin The number of the pin.
@@ -100,9 +145,142 @@ public:
 
     void attachInterrupt(uint8_t interruptNum, void(*userFunc)(void), int mode);
     void detachInterrupt(uint8_t interruptNum);
+    /**
+    * @brief Returns the number of edges of an interrupt lost because the
+    * edge queue was full.
+    */
+    uint32_t missedInterrupts(uint8_t interruptNum);
+    /**
+    * @brief Returns the micros() timestamp of the edge whose interrupt
+    * handler is currently executed.
+    */
+    unsigned long interruptMicros();
+    /**
+    * @brief Calls the pin interrupt handlers on a dedicated high priority
+    * thread as soon as the edge is decoded. noInterrupts() then blocks
+    * the handlers until interrupts() like on the real board.
+    */
+    void beginInterruptThread();
+    void endInterruptThread();
+    /**
+    * @brief Returns the count of interrupts whose handler started less than
+    * 2^bucket microseconds after the edge was decoded.
+    */
+    uint32_t interruptLatency(uint8_t bucket);
+    /**
+    * @brief Returns the latency in microseconds below which the given percentage
+    * of the interrupt handlers started, rounded up to a power of two.
+    */
+    unsigned long interruptLatencyPercentile(uint8_t percent);
+    void resetInterruptLatency();
+    /**
+    * @brief Attaches a comparator interrupt to an analog pin. It is evaluated
+    * on every received sample.
+    *
+    * @param pin The analog pin (A0, A1, ...).
+    * @param threshold The value at which the comparator switches to above.
+    * @param hysteresis The comparator switches to below under threshold - hysteresis.
+    * @param mode RISING, FALLING or CHANGE.
+    * @param userFunc The function to call.
+    */
+    void attachAnalogInterrupt(uint8_t pin, int threshold, int hysteresis, int mode, void(*userFunc)(void));
+    void detachAnalogInterrupt(uint8_t pin);
     void interrupts();
     void noInterrupts();
 
+    /**
+    * @brief Sets the time without reads after which the board stops reporting
+    * a digital port or analog channel. Reporting resumes with the next read.
+    *
+    * @param timeout in milliseconds, 0 keeps the reports switched on.
+    */
+    void setReportIdleTimeout(unsigned long timeout);
+    /**
+    * @brief Debounces a digital input before digitalRead() and the pin interrupts see it.
+    *
+    * @param pin The number of the pin.
+    * @param mode DEBOUNCE_TIME accepts a level stable for time ms,
+    * DEBOUNCE_INTEGRATOR one which dominated for time ms, DEBOUNCE_NONE switches off.
+    * @param time in milliseconds.
+    */
+    void setDebounce(uint8_t pin, uint8_t mode, uint16_t time);
+    /**
+    * @brief Sets a fixed interval the board samples and reports analog inputs.
+    *
+    * @param interval in milliseconds.
+    */
+    void setSamplingInterval(unsigned int interval);
+    /**
+    * @brief Lets the sampling interval follow the analog read rate of the sketch
+    * within the given limits and the bandwidth budget of the link.
+    *
+    * @param minInterval lower limit in milliseconds.
+    * @param maxInterval upper limit in milliseconds.
+    */
+    void setAdaptiveSampling(unsigned int minInterval, unsigned int maxInterval);
+
+    /**
+    * @brief Starts buffering every sample received for an analog pin together
+    * with its timestamp. The pin stays reported while capturing.
+    *
+    * @param pin The analog pin (A0, A1, ...).
+    * @param capacity Number of samples in the ring buffer.
+    * @return true if the buffer was allocated.
+    */
+    bool beginAnalogCapture(uint8_t pin, size_t capacity = CFI_CAPTURE_BUFFER_SIZE);
+    /**
+    * @brief Stops capturing and frees the buffer of an analog pin.
+    */
+    void endAnalogCapture(uint8_t pin);
+    /**
+    * @brief Returns the number of captured samples ready to read.
+    */
+    size_t analogCaptureAvailable(uint8_t pin);
+    /**
+    * @brief Reads up to count captured samples, oldest first.
+    *
+    * @return Number of samples copied into the array.
+    */
+    size_t readAnalogCapture(uint8_t pin, CFI_AnalogSample* samples, size_t count);
+    /**
+    * @brief Returns the number of samples dropped because the buffer was full.
+    */
+    uint32_t analogCaptureDropped(uint8_t pin);
+    /**
+    * @brief Streams the captured samples of an analog pin to a file.
+    *
+    * @param format CFI_CAPTURE_FORMAT_BINARY or CFI_CAPTURE_FORMAT_CSV.
+    * @return true if the file was opened.
+    */
+    bool beginAnalogExport(uint8_t pin, const char* fileName, uint8_t format = CFI_CAPTURE_FORMAT_BINARY);
+    /**
+    * @brief Writes the remaining samples and closes the export file.
+    */
+    void endAnalogExport(uint8_t pin);
+
+#if defined(VB_FIRMATA_PORT)
+    /**
+    * @brief Adds a further Firmata board to the pin space. Its pin n is used as
+    * pin firstPin + n, e.g. its A0 as firstPin + A0. The board is served by an
+    * own I/O thread, so the links of all boards run in parallel.
+    *
+    * attachInterrupt(), shift, ping, capture and the sampling interval stay with the
+    * first board. Analog interrupts of an added board are called in its I/O thread.
+    *
+    * @param stream The transport to the board, already opened.
+    * @param firstPin first pin in the pin space, a multiple of 8 for the ports,
+    * at least NUM_DIGITAL_PINS, the pins of the first board.
+    * @param pinCount number of pins of the board.
+    * @return false if the pins overlap the first or another added board or no more
+    * boards are possible.
+    */
+    bool addBoard(Stream& stream, uint8_t firstPin, uint8_t pinCount);
+    /**
+    * @brief Stops the I/O threads of the added boards.
+    */
+    void endBoards();
+#endif
+
     /**
      * @brief Overloaded assign operator.
      *
@@ -115,10 +293,47 @@ public:
 
   private:
 #if defined(VB_FIRMATA_PORT)
-    CFI_DigitalInputFeature* _digitalInput = NULL;
-    CFI_DigitalOutputFeature* _digitalOutput = NULL;
-    CFI_AnalogInputFeature* _analogInput = NULL;
-    CFI_AnalogOutputFeature* _analogOutput = NULL;
+    CFI_ShiftFeature* _shift = NULL;
+    CFI_PingFeature* _ping = NULL;
+
+    /* settings for the features created later */
+    bool _interruptThread = false;
+    bool _interruptsEnabled = true;
+    unsigned long _reportIdleTimeout = CFI_REPORT_IDLE_TIMEOUT;
+
+    typedef struct {
+        CFI_ClientFirmata* firmata;
+        CFI_DigitalInputFeature* digitalInput; // features are NULL until first used
+        CFI_DigitalOutputFeature* digitalOutput;
+        CFI_AnalogInputFeature* analogInput;
+        CFI_AnalogOutputFeature* analogOutput;
+        uint8_t firstPin;
+        std::recursive_mutex* mutex; // NULL for the first board, it is served by the main thread
+        std::thread* ioThread;
+    } board_t;
+
+    // Locks an added board against its I/O thread while a pin is accessed
+    class BoardLock
+    {
+    public:
+        BoardLock(board_t& board) : _mutex(board.mutex) { if (_mutex != NULL) _mutex->lock(); }
+        ~BoardLock() { if (_mutex != NULL) _mutex->unlock(); }
+    private:
+        std::recursive_mutex* _mutex;
+    };
+
+    board_t _boards[VB_FIRMATA_MAX_BOARDS];
+    uint8_t _boardCount = 1;
+    uint8_t _pinBoard[256] = {}; // index into _boards for each pin
+    std::atomic<bool> _boardsRunning;
+
+    void boardThread(board_t* board);
+
+    CFI_DigitalInputFeature* digitalInput(board_t& board);
+    CFI_DigitalOutputFeature* digitalOutput(board_t& board);
+    CFI_AnalogInputFeature* analogInput(board_t& board);
+    CFI_AnalogOutputFeature* analogOutput(board_t& board);
+    CFI_ShiftFeature* shift();
 #endif
 
 };
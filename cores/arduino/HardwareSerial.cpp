@@ -32,6 +32,7 @@
 #include "Arduino.h"
 
 #include "HardwareSerial.h"
+#include "utils/log.h"
 
 // this next line disables the entire HardwareSerial.cpp,
 // this is so I can support Attiny series and any other chip without a uart
@@ -48,56 +49,40 @@ HardwareSerial::HardwareSerial(const char *deviceName)
 {
   _deviceName = deviceName;
   _written = false;
+  _txHead = _txCount = 0;
+  _txBusy = false;
+  _txRunning = false;
+}
+
+HardwareSerial::~HardwareSerial()
+{
+  endTransmitThread();
 }
 
 void HardwareSerial::begin(unsigned long baud, byte config)
 {
   _written = false;
+  clearReceived();
 
   _serialInternal.setPort(_deviceName);
   _serialInternal.setBaudrate(baud);
   _serialInternal.open();
+  beginTransmitThread();
 }
 
 void HardwareSerial::end()
 {
   // wait for transmission of outgoing data
-  _serialInternal.flush();
+  flush();
+  endTransmitThread();
   _serialInternal.close();
-}
-
-int HardwareSerial::available(void)
-{
-  return _serialInternal.available();
-}
-
-int HardwareSerial::peek(void)
-{
-  // ToDo: return _serialInternal.peek();
-  return -1;
-}
-
-int HardwareSerial::read(void)
-{
-  uint8_t b = 0;
-  if (read((unsigned char*)&b, 1) >= 0) {
-    // read worked
-    return b;
-  } else {
-    // No data available
-    return -1;
-  }
-}
-
-int HardwareSerial::read(uint8_t *buf, size_t bytes)
-{
-    return _serialInternal.read(buf, bytes);
+  clearReceived();
 }
 
 int HardwareSerial::availableForWrite(void)
 {
-  // ToDo: add function to _serialInternal
-  return 64;
+  std::lock_guard<std::mutex> lock(_txMutex);
+  return (int)(sizeof(_txBuffer) - _txCount);
 }
 
 void HardwareSerial::flush()
@@ -108,7 +93,14 @@ void HardwareSerial::flush()
   if (!_written) {
     return;
   }
-  _serialInternal.flushOutput();
+  {
+    std::unique_lock<std::mutex> lock(_txMutex);
+    _txSignal.wait(lock, [this] { return !_txRunning || (_txCount == 0 && !_txBusy); });
+  }
+  if (_serialInternal.isOpen()) {
+    // the driver's buffer
+    _serialInternal.flush();
+  }
 }
 
 size_t HardwareSerial::write(uint8_t b)
@@ -116,15 +108,24 @@ size_t HardwareSerial::write(uint8_t b)
   return write(&b, 1);
 }
 
+// Returns as soon as the bytes are buffered, waits only while the buffer is full
 size_t HardwareSerial::write(const uint8_t *buf, size_t size)
 {
   _written = true;
 
+  std::unique_lock<std::mutex> lock(_txMutex);
   size_t bytes = 0;
-  while (size > 0) {
-    int rc = _serialInternal.write(buf + bytes, size);
-    bytes += rc;
-    size -= rc;
+  while (bytes < size) {
+    _txSignal.wait(lock, [this] { return !_txRunning || _txCount < sizeof(_txBuffer); });
+    if (!_txRunning) {
+      break;
+    }
+    size_t tail = (_txHead + _txCount) % sizeof(_txBuffer);
+    size_t chunk = min(size - bytes, min(sizeof(_txBuffer) - _txCount, sizeof(_txBuffer) - tail));
+    memcpy(_txBuffer + tail, buf + bytes, chunk);
+    _txCount += chunk;
+    bytes += chunk;
+    _txSignal.notify_all();
   }
   return bytes;
 }
@@ -145,4 +146,66 @@ size_t HardwareSerial::write(const char *buffer, size_t size)
   return write((const uint8_t *)buffer, size);
 }
 
+void HardwareSerial::beginTransmitThread()
+{
+  if (_txRunning) {
+    return;
+  }
+  _txHead = _txCount = 0;
+  _txBusy = false;
+  _txRunning = true;
+  _txThread = std::thread(&HardwareSerial::transmitThread, this);
+}
+
+void HardwareSerial::endTransmitThread()
+{
+  if (!_txRunning) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_txMutex);
+    _txRunning = false;
+  }
+  _txSignal.notify_all();
+  _txThread.join();
+  _txHead = _txCount = 0;
+}
+
+// Drains the transmit buffer, the sketch continues while the bytes are on the wire.
+// On Windows the port is a synchronous handle: the driver serialises all I/O on it,
+// so available() and read() of the sketch wait until the running write returns.
+// Writing SERIAL_TX_CHUNK_SIZE bytes at a time bounds that wait to the wire time
+// of one chunk (about 6 ms at 115200 baud) instead of the whole buffer.
+void HardwareSerial::transmitThread()
+{
+  std::unique_lock<std::mutex> lock(_txMutex);
+  while (true) {
+    _txSignal.wait(lock, [this] { return !_txRunning || _txCount > 0; });
+    if (!_txRunning) {
+      return;
+    }
+    // at most one chunk up to the end of the buffer, the rest follows with the next rounds
+    size_t chunk = min(min(_txCount, sizeof(_txBuffer) - _txHead), (size_t)SERIAL_TX_CHUNK_SIZE);
+    _txBusy = true;
+    lock.unlock();
+    size_t sent = 0;
+    try {
+      sent = _serialInternal.write(_txBuffer + _txHead, chunk);
+      if (sent == 0) {
+        // the driver's buffer is full
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    catch (const std::exception &e) {
+      logError("%s: %s\n", _deviceName, e.what());
+      sent = chunk; // drop the bytes, the port is lost
+    }
+    lock.lock();
+    _txBusy = false;
+    _txHead = (_txHead + sent) % sizeof(_txBuffer);
+    _txCount -= sent;
+    _txSignal.notify_all();
+  }
+}
+
 #endif // whole file
@@ -28,9 +28,23 @@
 #define HardwareSerial_h
 
 #include <inttypes.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
-#include "Stream.h"
-#include "serial/serial.h"
+#include "SerialStream.h"
+
+#if !defined(SERIAL_RX_BUFFER_SIZE)
+#define SERIAL_RX_BUFFER_SIZE 1024 // received bytes fetched from the driver with one read
+#endif
+
+#if !defined(SERIAL_TX_BUFFER_SIZE)
+#define SERIAL_TX_BUFFER_SIZE 1024 // bytes write() accepts before it waits for the transmission
+#endif
+
+#if !defined(SERIAL_TX_CHUNK_SIZE)
+#define SERIAL_TX_CHUNK_SIZE 64 // bytes handed to the driver with one write, see transmitThread()
+#endif
 
 // Define config for Serial.begin(baud, config);
 #define SERIAL_5N1 0x00
@@ -58,10 +72,22 @@
 #define SERIAL_7O2 0x3C
 #define SERIAL_8O2 0x3E
 
-class HardwareSerial : public Stream
+class HardwareSerial : public SerialStream<SERIAL_RX_BUFFER_SIZE>
 {
   private:
-    serial::SerialClass _serialInternal;
+    // bytes accepted by write() and sent by the transmit thread
+    uint8_t _txBuffer[SERIAL_TX_BUFFER_SIZE];
+    size_t _txHead;
+    size_t _txCount;
+    bool _txBusy; // the transmit thread is writing bytes which are still counted
+    bool _txRunning;
+    std::mutex _txMutex; // protects the transmit buffer
+    std::condition_variable _txSignal;
+    std::thread _txThread;
+
+    void beginTransmitThread();
+    void endTransmitThread();
+    void transmitThread();
 
   protected:
     const char *_deviceName;
@@ -70,15 +96,12 @@ class HardwareSerial : public Stream
 
   public:
     HardwareSerial(const char *win32Device);
+    ~HardwareSerial();
     void begin(unsigned long baud) {
       begin(baud, SERIAL_8N1);
     }
     void begin(unsigned long, uint8_t);
     void end();
-    virtual int available(void);
-    virtual int peek(void);
-    virtual int read(void);
-    virtual int read(uint8_t *buf, size_t bytes);
     virtual int availableForWrite(void);
     virtual void flush(void);
     virtual size_t write(uint8_t);
@@ -37,6 +37,16 @@ void detachInterrupt(uint8_t interruptNum)
   GPIO.detachInterrupt(interruptNum);
 }
 
+void attachAnalogInterrupt(uint8_t pin, int threshold, int hysteresis, int mode, void(*userFunc)(void))
+{
+  GPIO.attachAnalogInterrupt(pin, threshold, hysteresis, mode, userFunc);
+}
+
+void detachAnalogInterrupt(uint8_t pin)
+{
+  GPIO.detachAnalogInterrupt(pin);
+}
+
 void interrupts()
 {
   GPIO.interrupts();
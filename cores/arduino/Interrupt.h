@@ -40,6 +40,8 @@ extern "C" {
 
 void attachInterrupt(uint8_t interruptNum, void(*userFunc)(void), int mode);
 void detachInterrupt(uint8_t interruptNum);
+void attachAnalogInterrupt(uint8_t pin, int threshold, int hysteresis, int mode, void(*userFunc)(void));
+void detachAnalogInterrupt(uint8_t pin);
 void interrupts();
 void noInterrupts();
 
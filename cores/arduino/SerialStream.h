@@ -0,0 +1,177 @@
+/*
+ * SerialStream.h - Part of the VirtualBoard project
+ * https://github.com/virtual-maker/VirtualBoard
+ *
+ * Copyright (c) 2022 Immo Wache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SerialStream_h
+#define SerialStream_h
+
+#include <inttypes.h>
+#include <string.h>
+#include "Arduino.h"
+
+#include "Stream.h"
+#include "serial/serial.h"
+
+// The receive side of a serial port shared by HardwareSerial and
+// SoftwareSerial: the bytes the driver holds are fetched with one read
+// into a buffer of RX_SIZE bytes, the sketch reads them from there.
+template <size_t RX_SIZE>
+class SerialStream : public Stream
+{
+  protected:
+    serial::SerialClass _serialInternal;
+
+    SerialStream()
+    {
+      _rxHead = _rxTail = 0;
+      _rxPolled = 0;
+    }
+
+    // drops the bytes not yet read by the sketch
+    void clearReceived()
+    {
+      _rxHead = _rxTail = 0;
+    }
+
+  private:
+    // bytes read from the driver but not yet by the sketch
+    uint8_t _rxBuffer[RX_SIZE];
+    size_t _rxHead;
+    size_t _rxTail;
+    unsigned long _rxPolled; // millis of the last driver poll
+
+    void receive();
+
+  public:
+    virtual int available(void);
+    virtual bool waitAvailable(unsigned long timeout);
+    virtual int peek(void);
+    virtual int read(void);
+    virtual int read(uint8_t *buf, size_t bytes);
+    virtual size_t readBytes(char *buffer, size_t length);
+    using Stream::readBytes; // pull in readBytes(uint8_t *, size_t)
+};
+
+template <size_t RX_SIZE>
+int SerialStream<RX_SIZE>::available(void)
+{
+  // the buffered bytes are reported without asking the driver, which is
+  // polled at most once per millisecond while the sketch consumes them
+  if (_rxHead == _rxTail || millis() != _rxPolled) {
+    receive();
+  }
+  return (int)(_rxTail - _rxHead);
+}
+
+// Sleeps on the port instead of spinning in timedRead()
+template <size_t RX_SIZE>
+bool SerialStream<RX_SIZE>::waitAvailable(unsigned long timeout)
+{
+  if (_rxHead != _rxTail) {
+    return true;
+  }
+  if (!_serialInternal.isOpen()) {
+    return false;
+  }
+  return _serialInternal.waitReadable((uint32_t)timeout);
+}
+
+template <size_t RX_SIZE>
+int SerialStream<RX_SIZE>::peek(void)
+{
+  if (_rxHead == _rxTail) {
+    receive();
+    if (_rxHead == _rxTail) {
+      return -1;
+    }
+  }
+  return _rxBuffer[_rxHead];
+}
+
+template <size_t RX_SIZE>
+int SerialStream<RX_SIZE>::read(void)
+{
+  uint8_t b;
+  if (read(&b, 1) > 0) {
+    // read worked
+    return b;
+  } else {
+    // No data available
+    return -1;
+  }
+}
+
+template <size_t RX_SIZE>
+int SerialStream<RX_SIZE>::read(uint8_t *buf, size_t bytes)
+{
+  if (_rxHead == _rxTail) {
+    receive();
+    if (_rxHead == _rxTail) {
+      return -1;
+    }
+  }
+  size_t count = std::min(bytes, _rxTail - _rxHead);
+  memcpy(buf, _rxBuffer + _rxHead, count);
+  _rxHead += count;
+  return (int)count;
+}
+
+template <size_t RX_SIZE>
+size_t SerialStream<RX_SIZE>::readBytes(char *buffer, size_t length)
+{
+  size_t count = 0;
+  while (count < length) {
+    int bytes = read((uint8_t *)buffer + count, length - count);
+    if (bytes > 0) {
+      count += bytes;
+      continue;
+    }
+    // nothing buffered, wait for the next byte as Stream does
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+// Fetches all bytes the driver holds with one read
+template <size_t RX_SIZE>
+void SerialStream<RX_SIZE>::receive()
+{
+  _rxPolled = millis();
+  if (!_serialInternal.isOpen()) {
+    return;
+  }
+  if (_rxHead == _rxTail) {
+    _rxHead = _rxTail = 0;
+  } else if (_rxTail == sizeof(_rxBuffer) && _rxHead > 0) {
+    memmove(_rxBuffer, _rxBuffer + _rxHead, _rxTail - _rxHead);
+    _rxTail -= _rxHead;
+    _rxHead = 0;
+  }
+  size_t bytes = std::min(_serialInternal.available(), sizeof(_rxBuffer) - _rxTail);
+  if (bytes > 0) {
+    _rxTail += _serialInternal.read(_rxBuffer + _rxTail, bytes);
+  }
+}
+
+#endif
@@ -0,0 +1,324 @@
+/*
+ * SocketClient.cpp - Part of the VirtualBoard project
+ * https://github.com/virtual-maker/VirtualBoard
+ *
+ * Copyright (c) 2022 Immo Wache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <string.h>
+#include "Arduino.h"
+#include "SocketClient.h"
+#include "utils/log.h"
+
+#if defined(_MSC_VER)
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+
+static bool socketStartup()
+{
+	static bool started = false;
+	if (!started) {
+		WSADATA wsaData;
+		started = WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+		if (!started) {
+			logError("WSAStartup failed\n");
+		}
+	}
+	return started;
+}
+
+SocketClient::SocketClient() : _sock(-1), _port(0), _lastConnect(0), _rxHead(0), _rxTail(0), _txLength(0)
+{
+	_host[0] = '\0';
+}
+
+SocketClient::~SocketClient()
+{
+	close();
+}
+
+int SocketClient::connect(const char *host, uint16_t port)
+{
+	close();
+	strncpy(_host, host, sizeof(_host) - 1);
+	_host[sizeof(_host) - 1] = '\0';
+	_port = port;
+	return open() ? 1 : 0;
+}
+
+int SocketClient::connect(IPAddress ip, uint16_t port)
+{
+	return connect(ip.toString().c_str(), port);
+}
+
+bool SocketClient::open()
+{
+	_lastConnect = millis();
+	if (!socketStartup()) {
+		return false;
+	}
+
+	char service[8];
+	snprintf(service, sizeof(service), "%u", _port);
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	struct addrinfo *result = NULL;
+	if (getaddrinfo(_host, service, &hints, &result) != 0 || result == NULL) {
+		logError("connect: cannot resolve %s\n", _host);
+		return false;
+	}
+
+	SOCKET sock = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+	if (sock == INVALID_SOCKET) {
+		freeaddrinfo(result);
+		logError("connect: socket error %d\n", WSAGetLastError());
+		return false;
+	}
+
+	// connect non blocking, so an unreachable board does not stall the sketch forever
+	u_long mode = 1;
+	ioctlsocket(sock, FIONBIO, &mode);
+	int rc = ::connect(sock, result->ai_addr, (int)result->ai_addrlen);
+	freeaddrinfo(result);
+	if (rc == SOCKET_ERROR) {
+		int error = WSAGetLastError();
+		if (error != WSAEWOULDBLOCK && error != WSAEINPROGRESS) {
+			closesocket(sock);
+			logError("connect: %s:%u error %d\n", _host, _port, error);
+			return false;
+		}
+		fd_set writeSet, errorSet;
+		FD_ZERO(&writeSet);
+		FD_SET(sock, &writeSet);
+		FD_ZERO(&errorSet);
+		FD_SET(sock, &errorSet);
+		struct timeval timeout;
+		timeout.tv_sec = SOCKETCLIENT_CONNECT_TIMEOUT / 1000;
+		timeout.tv_usec = (SOCKETCLIENT_CONNECT_TIMEOUT % 1000) * 1000;
+		rc = select((int)sock + 1, NULL, &writeSet, &errorSet, &timeout);
+		if (rc <= 0 || FD_ISSET(sock, &errorSet)) {
+			closesocket(sock);
+			logError("connect: %s:%u %s\n", _host, _port, rc == 0 ? "timed out" : "refused");
+			return false;
+		}
+	}
+	mode = 0;
+	ioctlsocket(sock, FIONBIO, &mode);
+
+	// Firmata messages are only a few bytes, never wait for more data to fill a segment
+	int noDelay = 1;
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *)&noDelay, sizeof(noDelay));
+
+	_sock = (intptr_t)sock;
+	_rxHead = _rxTail = 0;
+	return true;
+}
+
+void SocketClient::close()
+{
+	if (_sock != -1) {
+		closesocket((SOCKET)_sock);
+		_sock = -1;
+	}
+	_rxHead = _rxTail = 0;
+	_txLength = 0;
+}
+
+bool SocketClient::reconnect()
+{
+	if (_sock != -1) {
+		return true;
+	}
+#if SOCKETCLIENT_RECONNECT_INTERVAL > 0
+	if (_host[0] != '\0' && millis() - _lastConnect >= SOCKETCLIENT_RECONNECT_INTERVAL) {
+		if (open()) {
+			logNotice("reconnected to %s:%u\n", _host, _port);
+			return true;
+		}
+	}
+#endif
+	return false;
+}
+
+bool SocketClient::send()
+{
+	size_t sent = 0;
+	while (sent < _txLength) {
+		int rc = ::send((SOCKET)_sock, (const char *)_txBuffer + sent, (int)(_txLength - sent), 0);
+		if (rc == SOCKET_ERROR) {
+			logError("send: error %d\n", WSAGetLastError());
+			close();
+			return false;
+		}
+		sent += rc;
+	}
+	_txLength = 0;
+	return true;
+}
+
+void SocketClient::receive()
+{
+	if (!reconnect()) {
+		return;
+	}
+	if (_txLength > 0 && !send()) {
+		return;
+	}
+	if (_rxHead == _rxTail) {
+		_rxHead = _rxTail = 0;
+	}
+	if (_rxTail == sizeof(_rxBuffer)) {
+		return;
+	}
+
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET((SOCKET)_sock, &readSet);
+	struct timeval timeout = { 0, 0 };
+	if (select((int)_sock + 1, &readSet, NULL, NULL, &timeout) <= 0) {
+		return;
+	}
+	int rc = recv((SOCKET)_sock, (char *)_rxBuffer + _rxTail, (int)(sizeof(_rxBuffer) - _rxTail), 0);
+	if (rc > 0) {
+		_rxTail += rc;
+	} else {
+		// 0 = closed by the board, keep the unread bytes
+		size_t head = _rxHead, tail = _rxTail;
+		logError("connection to %s:%u lost\n", _host, _port);
+		close();
+		_rxHead = head;
+		_rxTail = tail;
+	}
+}
+
+size_t SocketClient::write(uint8_t b)
+{
+	return write(&b, 1);
+}
+
+size_t SocketClient::write(const uint8_t *buf, size_t size)
+{
+	if (!reconnect()) {
+		// drop the bytes while the board is gone, as a serial port without a peer does
+		return size;
+	}
+	size_t bytes = 0;
+	while (bytes < size) {
+		if (_txLength == sizeof(_txBuffer) && !send()) {
+			return size; // connection lost, the rest is dropped
+		}
+		size_t chunk = min(size - bytes, sizeof(_txBuffer) - _txLength);
+		memcpy(_txBuffer + _txLength, buf + bytes, chunk);
+		_txLength += chunk;
+		bytes += chunk;
+	}
+	return bytes;
+}
+
+int SocketClient::availableForWrite()
+{
+	return (int)(sizeof(_txBuffer) - _txLength);
+}
+
+int SocketClient::available()
+{
+	receive();
+	return (int)(_rxTail - _rxHead);
+}
+
+bool SocketClient::waitAvailable(unsigned long timeout)
+{
+	receive();
+	if (_rxHead != _rxTail) {
+		return true;
+	}
+	if (_sock == -1 || timeout == 0) {
+		return false;
+	}
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET((SOCKET)_sock, &readSet);
+	struct timeval wait = { (long)(timeout / 1000), (long)(timeout % 1000) * 1000 };
+	if (select((int)_sock + 1, &readSet, NULL, NULL, &wait) <= 0) {
+		return false;
+	}
+	receive();
+	return _rxHead != _rxTail;
+}
+
+int SocketClient::read()
+{
+	uint8_t b;
+	if (read(&b, 1) > 0) {
+		return b;
+	}
+	return -1;
+}
+
+int SocketClient::read(uint8_t *buf, size_t size)
+{
+	if (_rxHead == _rxTail) {
+		receive();
+		if (_rxHead == _rxTail) {
+			return -1;
+		}
+	}
+	size_t bytes = min(size, _rxTail - _rxHead);
+	memcpy(buf, _rxBuffer + _rxHead, bytes);
+	_rxHead += bytes;
+	return (int)bytes;
+}
+
+int SocketClient::peek()
+{
+	if (_rxHead == _rxTail) {
+		receive();
+		if (_rxHead == _rxTail) {
+			return -1;
+		}
+	}
+	return _rxBuffer[_rxHead];
+}
+
+void SocketClient::flush()
+{
+	if (_sock != -1 && _txLength > 0) {
+		send();
+	}
+}
+
+void SocketClient::stop()
+{
+	flush();
+	close();
+	_host[0] = '\0';
+}
+
+uint8_t SocketClient::connected()
+{
+	return _sock != -1 || _rxHead != _rxTail;
+}
+
+SocketClient::operator bool()
+{
+	return _sock != -1;
+}
@@ -0,0 +1,176 @@
+/*
+ * SocketClient.h - Part of the VirtualBoard project
+ * https://github.com/virtual-maker/VirtualBoard
+ *
+ * Copyright (c) 2022 Immo Wache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SocketClient_h
+#define SocketClient_h
+
+#include "Client.h"
+#include "IPAddress.h"
+
+#if !defined(SOCKETCLIENT_RX_BUFFER_SIZE)
+#define SOCKETCLIENT_RX_BUFFER_SIZE 1024
+#endif
+
+#if !defined(SOCKETCLIENT_TX_BUFFER_SIZE)
+#define SOCKETCLIENT_TX_BUFFER_SIZE 1460 // one TCP segment on Ethernet
+#endif
+
+#if !defined(SOCKETCLIENT_CONNECT_TIMEOUT)
+#define SOCKETCLIENT_CONNECT_TIMEOUT 2000 // ms
+#endif
+
+#if !defined(SOCKETCLIENT_RECONNECT_INTERVAL)
+#define SOCKETCLIENT_RECONNECT_INTERVAL 1000 // ms between reconnect attempts, 0 = never reconnect
+#endif
+
+/**
+ * @brief Buffered TCP client on a host socket, e.g. the transport to a
+ * StandardFirmataEthernet or StandardFirmataWiFi board.
+ *
+ * Written bytes are collected and sent as one segment with TCP_NODELAY when
+ * the buffer is full, on flush() and before any read access, so all messages
+ * of one loop pass leave the host together. A lost connection is
+ * re-established on the next access.
+ */
+class SocketClient : public Client
+{
+
+public:
+	/**
+	 * @brief SocketClient constructor.
+	 */
+	SocketClient();
+	/**
+	 * @brief SocketClient destructor, closes the connection.
+	 */
+	~SocketClient();
+	/**
+	 * @brief Initiate a connection with host:port.
+	 *
+	 * @param host name to resolve or a stringified dotted IP address.
+	 * @param port to connect to.
+	 * @return 1 if SUCCESS or 0 if FAILURE.
+	 */
+	virtual int connect(const char *host, uint16_t port);
+	/**
+	 * @brief Initiate a connection with ip:port.
+	 *
+	 * @param ip to connect to.
+	 * @param port to connect to.
+	 * @return 1 if SUCCESS or 0 if FAILURE.
+	 */
+	virtual int connect(IPAddress ip, uint16_t port);
+	/**
+	 * @brief Write a byte into the send buffer.
+	 *
+	 * @param b byte to write.
+	 * @return 0 if FAILURE or 1 if SUCCESS.
+	 */
+	virtual size_t write(uint8_t b);
+	/**
+	 * @brief Write 'size' bytes into the send buffer.
+	 *
+	 * @param buf Buffer to read from.
+	 * @param size of the buffer.
+	 * @return 0 if FAILURE or the number of bytes written.
+	 */
+	virtual size_t write(const uint8_t *buf, size_t size);
+
+	using Print::write; // pull in write(str) and write(buf, size) from Print
+
+	/**
+	 * @brief Free space in the send buffer.
+	 */
+	virtual int availableForWrite();
+	/**
+	 * @brief Returns the number of bytes available for reading.
+	 *
+	 * @return number of bytes available.
+	 */
+	virtual int available();
+	/**
+	 * @brief Sleeps until bytes are available or the timeout elapsed.
+	 *
+	 * @param timeout in ms.
+	 * @return true if bytes are available.
+	 */
+	virtual bool waitAvailable(unsigned long timeout);
+	/**
+	 * @brief Read a byte.
+	 *
+	 * @return -1 if no data, else the first byte available.
+	 */
+	virtual int read();
+	/**
+	 * @brief Read a number of bytes and store in a buffer.
+	 *
+	 * @param buf buffer to write to.
+	 * @param size number of bytes to read.
+	 * @return -1 if no data or number of read bytes.
+	 */
+	virtual int read(uint8_t *buf, size_t size);
+	/**
+	 * @brief Returns the next byte of the read queue without removing it from the queue.
+	 *
+	 * @return -1 if no data, else the first byte of incoming data available.
+	 */
+	virtual int peek();
+	/**
+	 * @brief Sends the buffered bytes.
+	 */
+	virtual void flush();
+	/**
+	 * @brief Close the connection, no reconnect until the next connect().
+	 */
+	virtual void stop();
+	/**
+	 * @brief Whether or not the client is connected.
+	 *
+	 * @return 1 if the client is connected, 0 if not.
+	 */
+	virtual uint8_t connected();
+	/**
+	 * @brief Overloaded cast operators.
+	 *
+	 * Allow SocketClient objects to be used where a bool is expected.
+	 */
+	virtual operator bool();
+
+private:
+	bool open();
+	void close();
+	bool reconnect();
+	bool send();
+	void receive();
+
+	intptr_t _sock; //!< @brief Host socket, -1 if closed.
+	char _host[64];
+	uint16_t _port;
+	unsigned long _lastConnect;
+
+	uint8_t _rxBuffer[SOCKETCLIENT_RX_BUFFER_SIZE];
+	size_t _rxHead;
+	size_t _rxTail;
+	uint8_t _txBuffer[SOCKETCLIENT_TX_BUFFER_SIZE];
+	size_t _txLength;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * SocketUDP.cpp - Part of the VirtualBoard project
+ * https://github.com/virtual-maker/VirtualBoard
+ *
+ * Copyright (c) 2022 Immo Wache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <string.h>
+#include "Arduino.h"
+#include "SocketUDP.h"
+#include "utils/log.h"
+
+SocketUDP::SocketUDP() : _sock(-1), _remotePort(0), _sendPort(0), _dropped(0), _rxHead(0), _rxLength(0),
+	_txLength(0)
+{
+}
+
+SocketUDP::~SocketUDP()
+{
+	stop();
+}
+
+uint8_t SocketUDP::begin(uint16_t port)
+{
+	stop();
+	if (!socketStartup()) {
+		return 0;
+	}
+	SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock == INVALID_SOCKET) {
+		logError("udp: socket error %d\n", WSAGetLastError());
+		return 0;
+	}
+	struct sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(port);
+	if (bind(sock, (struct sockaddr *)&local, sizeof(local)) == SOCKET_ERROR) {
+		logError("udp: bind to port %u error %d\n", port, WSAGetLastError());
+		closesocket(sock);
+		return 0;
+	}
+	u_long mode = 1;
+	ioctlsocket(sock, FIONBIO, &mode);
+	_sock = (intptr_t)sock;
+	_dropped = 0;
+	return 1;
+}
+
+void SocketUDP::stop()
+{
+	if (_sock != -1) {
+		closesocket((SOCKET)_sock);
+		_sock = -1;
+	}
+	_rxHead = _rxLength = 0;
+	_txLength = 0;
+}
+
+int SocketUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+	_sendIP = ip;
+	_sendPort = port;
+	_txLength = 0;
+	return 1;
+}
+
+int SocketUDP::beginPacket(const char *host, uint16_t port)
+{
+	IPAddress ip;
+	if (!ip.fromString(host)) {
+		struct addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		struct addrinfo *result = NULL;
+		if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL) {
+			logError("udp: cannot resolve %s\n", host);
+			return 0;
+		}
+		ip = IPAddress((uint32_t)((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr);
+		freeaddrinfo(result);
+	}
+	return beginPacket(ip, port);
+}
+
+int SocketUDP::endPacket()
+{
+	if (_sock == -1) {
+		return 0;
+	}
+	struct sockaddr_in remote;
+	memset(&remote, 0, sizeof(remote));
+	remote.sin_family = AF_INET;
+	remote.sin_addr.s_addr = (uint32_t)_sendIP;
+	remote.sin_port = htons(_sendPort);
+	int rc = sendto((SOCKET)_sock, (const char *)_txBuffer, (int)_txLength, 0, (struct sockaddr *)&remote,
+	                sizeof(remote));
+	_txLength = 0;
+	if (rc == SOCKET_ERROR) {
+		logError("udp: send error %d\n", WSAGetLastError());
+		return 0;
+	}
+	return 1;
+}
+
+size_t SocketUDP::write(uint8_t b)
+{
+	return write(&b, 1);
+}
+
+size_t SocketUDP::write(const uint8_t *buffer, size_t size)
+{
+	size_t bytes = min(size, sizeof(_txBuffer) - _txLength);
+	memcpy(_txBuffer + _txLength, buffer, bytes);
+	_txLength += bytes;
+	return bytes;
+}
+
+int SocketUDP::parsePacket()
+{
+	_rxHead = _rxLength = 0;
+	if (_sock == -1) {
+		return 0;
+	}
+	while (true) {
+		struct sockaddr_in remote;
+		socklen_t remoteSize = sizeof(remote);
+		int rc = recvfrom((SOCKET)_sock, (char *)_rxBuffer, sizeof(_rxBuffer), 0, (struct sockaddr *)&remote,
+		                  &remoteSize);
+		if (rc == SOCKET_ERROR) {
+			int error = WSAGetLastError();
+			if (error == WSAEMSGSIZE) {
+				// a truncated datagram would cut a message, skip it
+				_dropped++;
+				continue;
+			}
+			if (error == WSAECONNRESET) {
+				// ICMP port unreachable of an earlier sendto(), not an error of this socket
+				continue;
+			}
+			return 0;
+		}
+		_remoteIP = IPAddress((uint32_t)remote.sin_addr.s_addr);
+		_remotePort = ntohs(remote.sin_port);
+		_rxLength = rc;
+		return rc;
+	}
+}
+
+int SocketUDP::available()
+{
+	return (int)(_rxLength - _rxHead);
+}
+
+int SocketUDP::read()
+{
+	if (_rxHead == _rxLength) {
+		return -1;
+	}
+	return _rxBuffer[_rxHead++];
+}
+
+int SocketUDP::read(unsigned char *buffer, size_t len)
+{
+	size_t bytes = min(len, _rxLength - _rxHead);
+	memcpy(buffer, _rxBuffer + _rxHead, bytes);
+	_rxHead += bytes;
+	return (int)bytes;
+}
+
+int SocketUDP::read(char *buffer, size_t len)
+{
+	return read((unsigned char *)buffer, len);
+}
+
+int SocketUDP::peek()
+{
+	if (_rxHead == _rxLength) {
+		return -1;
+	}
+	return _rxBuffer[_rxHead];
+}
+
+void SocketUDP::flush()
+{
+	_rxHead = _rxLength;
+}
+
+IPAddress SocketUDP::remoteIP()
+{
+	return _remoteIP;
+}
+
+uint16_t SocketUDP::remotePort()
+{
+	return _remotePort;
+}
+
+unsigned long SocketUDP::droppedPackets()
+{
+	return _dropped;
+}
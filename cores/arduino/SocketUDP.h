@@ -0,0 +1,103 @@
+/*
+ * SocketUDP.h - Part of the VirtualBoard project
+ * https://github.com/virtual-maker/VirtualBoard
+ *
+ * Copyright (c) 2022 Immo Wache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SocketUDP_h
+#define SocketUDP_h
+
+#include "Udp.h"
+#include "IPAddress.h"
+
+#if !defined(SOCKETUDP_PACKET_SIZE)
+#define SOCKETUDP_PACKET_SIZE 1472 // largest datagram without IP fragmentation on Ethernet
+#endif
+
+/**
+ * @brief UDP on a host socket, e.g. for Firmata reports of a network board.
+ *
+ * Received datagrams are read one by one with parsePacket(), written bytes
+ * are collected between beginPacket() and endPacket().
+ */
+class SocketUDP : public UDP
+{
+
+public:
+	/**
+	 * @brief SocketUDP constructor.
+	 */
+	SocketUDP();
+	/**
+	 * @brief SocketUDP destructor, closes the socket.
+	 */
+	~SocketUDP();
+	/**
+	 * @brief Start listening on the local port.
+	 *
+	 * @param port local port, 0 = any free port.
+	 * @return 1 if SUCCESS or 0 if FAILURE.
+	 */
+	virtual uint8_t begin(uint16_t port);
+	/**
+	 * @brief Close the socket.
+	 */
+	virtual void stop();
+	virtual int beginPacket(IPAddress ip, uint16_t port);
+	virtual int beginPacket(const char *host, uint16_t port);
+	virtual int endPacket();
+	virtual size_t write(uint8_t b);
+	virtual size_t write(const uint8_t *buffer, size_t size);
+
+	using Print::write; // pull in write(str) and write(buf, size) from Print
+
+	/**
+	 * @brief Read the next datagram, drops the rest of the current one.
+	 *
+	 * @return size of the datagram or 0 if none is available.
+	 */
+	virtual int parsePacket();
+	virtual int available();
+	virtual int read();
+	virtual int read(unsigned char *buffer, size_t len);
+	virtual int read(char *buffer, size_t len);
+	virtual int peek();
+	virtual void flush();
+	virtual IPAddress remoteIP();
+	virtual uint16_t remotePort();
+	/**
+	 * @brief Number of datagrams dropped since begin() because they were truncated.
+	 */
+	unsigned long droppedPackets();
+
+private:
+	intptr_t _sock; //!< @brief Host socket, -1 if closed.
+	IPAddress _remoteIP;
+	uint16_t _remotePort;
+	IPAddress _sendIP;
+	uint16_t _sendPort;
+	unsigned long _dropped;
+
+	uint8_t _rxBuffer[SOCKETUDP_PACKET_SIZE];
+	size_t _rxHead;
+	size_t _rxLength;
+	uint8_t _txBuffer[SOCKETUDP_PACKET_SIZE];
+	size_t _txLength;
+};
+
+#endif
@@ -37,6 +37,10 @@ int Stream::timedRead()
 		if(c >= 0) {
 			return c;
 		}
+		unsigned long elapsed = millis() - _startMillis;
+		if(elapsed < _timeout) {
+			waitAvailable(min(_timeout - elapsed, (unsigned long)STREAM_WAIT_SLICE));
+		}
 		yield();
 	} while(millis() - _startMillis < _timeout);
 	return -1;     // -1 indicates timeout
@@ -52,6 +56,10 @@ int Stream::timedPeek()
 		if(c >= 0) {
 			return c;
 		}
+		unsigned long elapsed = millis() - _startMillis;
+		if(elapsed < _timeout) {
+			waitAvailable(min(_timeout - elapsed, (unsigned long)STREAM_WAIT_SLICE));
+		}
 		yield();
 	} while(millis() - _startMillis < _timeout);
 	return -1;     // -1 indicates timeout
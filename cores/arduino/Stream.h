@@ -26,6 +26,10 @@
 #include <inttypes.h>
 #include "Print.h"
 
+#if !defined(STREAM_WAIT_SLICE)
+#define STREAM_WAIT_SLICE 1 // ms a timed read sleeps in waitAvailable() before it calls yield() again
+#endif
+
 // compatability macros for testing
 /*
  #define   getInt()            parseInt()
@@ -53,6 +57,14 @@ public:
 	virtual int peek() = 0;
 	virtual void flush() = 0;
 
+	// Sleeps until input is available or timeout ms elapsed, returns true
+	// if input is available. Streams without a way to wait return at once.
+	virtual bool waitAvailable(unsigned long timeout)
+	{
+		(void)timeout;
+		return available() > 0;
+	}
+
 	Stream()
 	{
 		_timeout = 1000;
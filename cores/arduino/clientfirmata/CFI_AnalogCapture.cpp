@@ -0,0 +1,166 @@
+/*
+  CFI_AnalogCapture.cpp - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#include "CFI_AnalogCapture.h"
+
+#define CFI_CAPTURE_EXPORT_CHUNK 64
+
+CFI_AnalogCapture::CFI_AnalogCapture() : _buffer(NULL), _mask(0), _head(0), _tail(0), _dropped(0),
+    _file(NULL), _channel(0), _format(CFI_CAPTURE_FORMAT_BINARY)
+{
+}
+
+CFI_AnalogCapture::~CFI_AnalogCapture()
+{
+    end();
+}
+
+bool CFI_AnalogCapture::begin(size_t capacity)
+{
+    end();
+
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    _buffer = new (std::nothrow) CFI_AnalogSample[size];
+    if (_buffer == NULL) {
+        return false;
+    }
+    _mask = size - 1;
+    _head.store(0);
+    _tail.store(0);
+    _dropped.store(0);
+    return true;
+}
+
+void CFI_AnalogCapture::end()
+{
+    endExport();
+    delete[] _buffer;
+    _buffer = NULL;
+    _mask = 0;
+}
+
+bool CFI_AnalogCapture::isActive()
+{
+    return _buffer != NULL;
+}
+
+void CFI_AnalogCapture::push(uint16_t value)
+{
+    size_t head = _head.load(std::memory_order_relaxed);
+    size_t tail = _tail.load(std::memory_order_acquire);
+    if (head - tail > _mask) {
+        // buffer full, keep the older samples
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    CFI_AnalogSample& sample = _buffer[head & _mask];
+    sample.timestamp = micros();
+    sample.value = value;
+    _head.store(head + 1, std::memory_order_release);
+}
+
+size_t CFI_AnalogCapture::available()
+{
+    if (_buffer == NULL) {
+        return 0;
+    }
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed);
+}
+
+size_t CFI_AnalogCapture::read(CFI_AnalogSample* samples, size_t count)
+{
+    if (_buffer == NULL) {
+        return 0;
+    }
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    size_t head = _head.load(std::memory_order_acquire);
+    size_t n = min(count, head - tail);
+
+    // copy in at most two contiguous blocks
+    size_t first = min(n, _mask + 1 - (tail & _mask));
+    memcpy(samples, &_buffer[tail & _mask], first * sizeof(CFI_AnalogSample));
+    memcpy(samples + first, &_buffer[0], (n - first) * sizeof(CFI_AnalogSample));
+
+    _tail.store(tail + n, std::memory_order_release);
+    return n;
+}
+
+uint32_t CFI_AnalogCapture::dropped()
+{
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+bool CFI_AnalogCapture::beginExport(byte channel, const char* fileName, byte format)
+{
+    if (_buffer == NULL) {
+        return false;
+    }
+    endExport();
+
+    _file = fopen(fileName, format == CFI_CAPTURE_FORMAT_CSV ? "w" : "wb");
+    if (_file == NULL) {
+        logError("Can't open capture file %s\n", fileName);
+        return false;
+    }
+    _channel = channel;
+    _format = format;
+    if (_format == CFI_CAPTURE_FORMAT_CSV) {
+        fprintf(_file, "timestamp_us,channel,value\n");
+    } else {
+        // header: magic, format version, channel, then 6 bytes per sample
+        // (uint32_t timestamp, uint16_t value, little endian)
+        const byte header[6] = { 'C', 'F', 'I', 'A', 1, channel };
+        fwrite(header, 1, sizeof(header), _file);
+    }
+    return true;
+}
+
+void CFI_AnalogCapture::endExport()
+{
+    if (_file != NULL) {
+        exportSamples();
+        fclose(_file);
+        _file = NULL;
+    }
+}
+
+// Stream all buffered samples to the export file
+void CFI_AnalogCapture::exportSamples()
+{
+    if (_file == NULL) {
+        return;
+    }
+    CFI_AnalogSample samples[CFI_CAPTURE_EXPORT_CHUNK];
+    byte record[CFI_CAPTURE_EXPORT_CHUNK * 6];
+    size_t n;
+    while ((n = read(samples, CFI_CAPTURE_EXPORT_CHUNK)) > 0) {
+        if (_format == CFI_CAPTURE_FORMAT_CSV) {
+            for (size_t i = 0; i < n; i++) {
+                fprintf(_file, "%lu,%u,%u\n", (unsigned long)samples[i].timestamp, _channel, samples[i].value);
+            }
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                byte* r = &record[i * 6];
+                r[0] = samples[i].timestamp & 0xFF;
+                r[1] = (samples[i].timestamp >> 8) & 0xFF;
+                r[2] = (samples[i].timestamp >> 16) & 0xFF;
+                r[3] = (samples[i].timestamp >> 24) & 0xFF;
+                r[4] = samples[i].value & 0xFF;
+                r[5] = (samples[i].value >> 8) & 0xFF;
+            }
+            fwrite(record, 6, n, _file);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/*
+  CFI_AnalogCapture.h - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#ifndef CFI_AnalogCapture_h
+#define CFI_AnalogCapture_h
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+
+#if !defined(CFI_CAPTURE_BUFFER_SIZE)
+#define CFI_CAPTURE_BUFFER_SIZE 4096 // samples per channel, rounded up to a power of two
+#endif
+
+#define CFI_CAPTURE_FORMAT_BINARY 0
+#define CFI_CAPTURE_FORMAT_CSV    1
+
+typedef struct {
+    uint32_t timestamp; // micros() when the ANALOG_MESSAGE was decoded
+    uint16_t value;
+} CFI_AnalogSample;
+
+// Single producer (the Firmata parser) / single consumer (the sketch or the
+// file export) ring buffer of the samples of one analog channel.
+class CFI_AnalogCapture
+{
+public:
+    CFI_AnalogCapture();
+    ~CFI_AnalogCapture();
+
+    bool begin(size_t capacity);
+    void end();
+    bool isActive();
+
+    void push(uint16_t value);
+    size_t available();
+    size_t read(CFI_AnalogSample* samples, size_t count);
+    uint32_t dropped();
+
+    bool beginExport(byte channel, const char* fileName, byte format);
+    void endExport();
+    void exportSamples();
+
+private:
+    CFI_AnalogSample* _buffer;
+    size_t _mask;
+    std::atomic<size_t> _head; // written by the producer only
+    std::atomic<size_t> _tail; // written by the consumer only
+    std::atomic<uint32_t> _dropped;
+
+    FILE* _file;
+    byte _channel;
+    byte _format;
+};
+
+#endif
@@ -12,11 +12,19 @@
 
 #include "CFI_AnalogInputFeature.h"
 
-CFI_AnalogInputFeature::CFI_AnalogInputFeature(CFI_ClientFirmata &firmata) : _firmata(&firmata)
+CFI_AnalogInputFeature::CFI_AnalogInputFeature(CFI_ClientFirmata &firmata) : _firmata(&firmata),
+  _reportIdleTimeout(CFI_REPORT_IDLE_TIMEOUT), _adaptiveSampling(false),
+  _minSamplingInterval(CFI_MIN_SAMPLING_INTERVAL), _maxSamplingInterval(CFI_MAX_SAMPLING_INTERVAL),
+  _readCount(0), _adaptStartMillis(0), _adaptStartBytes(0)
 {
   for (size_t i = 0; i < 16; i++) {
     _analogPorts[i] = 0;
+    _subscribers[i] = 0;
     _reportPorts[i] = false;
+    _pendingPorts[i] = false;
+    _lastRead[i] = 0;
+    _comparators[i].func = NULL;
+    _comparators[i].pending = false;
   }
   _firmata->attach(*this);
 }
@@ -25,6 +33,13 @@ void CFI_AnalogInputFeature::setAnalogPort(byte analogPin, int value)
 {
   if (analogPin < 16) {
     _analogPorts[analogPin] = value;
+    _pendingPorts[analogPin] = false;
+    if (_capture[analogPin].isActive()) {
+      _capture[analogPin].push(value);
+    }
+    if (_comparators[analogPin].func != NULL) {
+      evaluateComparator(analogPin, value);
+    }
   }
 }
 
@@ -35,26 +50,286 @@ void CFI_AnalogInputFeature::setPinMode(byte pin, int mode)
   _firmata->setPinMode(analogPin, mode);
 }
 
-void CFI_AnalogInputFeature::reportAnalogPort(byte port)
+// Subscribers keep the channel reported regardless of the idle timeout.
+// Without subscribers a channel is reported as long as it is read.
+void CFI_AnalogInputFeature::subscribe(byte analogPin)
+{
+  if (analogPin < 16) {
+    if (_subscribers[analogPin] < 255) {
+      _subscribers[analogPin]++;
+    }
+    _lastRead[analogPin] = millis();
+    if (!_reportPorts[analogPin]) {
+      setPinMode(analogPin, CFI_PIN_MODE_ANALOG);
+      reportAnalogPort(analogPin, true);
+    }
+  }
+}
+
+void CFI_AnalogInputFeature::unsubscribe(byte analogPin)
+{
+  if (analogPin < 16 && _subscribers[analogPin] > 0) {
+    _subscribers[analogPin]--;
+    _lastRead[analogPin] = millis();
+  }
+}
+
+void CFI_AnalogInputFeature::setReportIdleTimeout(unsigned long timeout)
+{
+  _reportIdleTimeout = timeout;
+}
+
+// A fixed sampling interval switches the adaptive policy off
+void CFI_AnalogInputFeature::setSamplingInterval(unsigned int interval)
+{
+  _adaptiveSampling = false;
+  _firmata->setSamplingInterval(interval);
+}
+
+// Let the sampling interval follow the rate the sketch reads analog
+// values, limited by the bandwidth budget of the link.
+void CFI_AnalogInputFeature::setAdaptiveSampling(unsigned int minInterval, unsigned int maxInterval)
+{
+  _minSamplingInterval = max(minInterval, 1u);
+  _maxSamplingInterval = max(maxInterval, _minSamplingInterval);
+  _readCount = 0;
+  _adaptStartMillis = millis();
+  _adaptStartBytes = _firmata->getBytesReceived();
+  _adaptiveSampling = true;
+}
+
+void CFI_AnalogInputFeature::adaptSamplingInterval()
+{
+  unsigned long now = millis();
+  unsigned long elapsed = now - _adaptStartMillis;
+  if (elapsed < CFI_SAMPLING_ADAPT_PERIOD) {
+    return;
+  }
+
+  unsigned long channels = 0;
+  for (byte port = 0; port < 16; port++) {
+    if (_reportPorts[port]) {
+      channels++;
+    }
+  }
+
+  unsigned long current = _firmata->getSamplingInterval();
+  unsigned long interval = _maxSamplingInterval;
+  if (channels > 0 && _readCount > 0) {
+    // sample each channel about as often as the sketch reads it
+    interval = constrain(elapsed * channels / _readCount,
+                         (unsigned long)_minSamplingInterval, (unsigned long)_maxSamplingInterval);
+  }
+
+  unsigned long baudRate = _firmata->getLinkBaudRate();
+  if (baudRate > 0 && channels > 0) {
+    // bytes per second left for analog reports, 10 bits per byte on the wire
+    unsigned long budget = baudRate / 10 * CFI_SAMPLING_LINK_LOAD / 100;
+    // each ANALOG_MESSAGE has 3 bytes
+    unsigned long budgetInterval = (channels * 3 * 1000 + budget - 1) / budget;
+    interval = max(interval, budgetInterval);
+
+    // relax while the total incoming traffic exceeds the budget
+    unsigned long received = _firmata->getBytesReceived() - _adaptStartBytes;
+    if (received * 1000 / elapsed > budget) {
+      interval = max(interval, min(current * 2, (unsigned long)0x3FFF));
+    }
+  }
+
+  if (interval != current) {
+    _firmata->setSamplingInterval((unsigned int)interval);
+  }
+
+  _readCount = 0;
+  _adaptStartMillis = now;
+  _adaptStartBytes = _firmata->getBytesReceived();
+}
+
+// In capture mode every received sample is buffered with its timestamp.
+// The capture holds a subscription, so the channel stays reported.
+bool CFI_AnalogInputFeature::beginCapture(byte analogPin, size_t capacity)
+{
+  if (analogPin >= 16) {
+    return false;
+  }
+  bool wasActive = _capture[analogPin].isActive();
+  if (!_capture[analogPin].begin(capacity)) {
+    if (wasActive) {
+      unsubscribe(analogPin);
+    }
+    return false;
+  }
+  if (!wasActive) {
+    subscribe(analogPin);
+  }
+  return true;
+}
+
+void CFI_AnalogInputFeature::endCapture(byte analogPin)
+{
+  if (analogPin < 16 && _capture[analogPin].isActive()) {
+    _capture[analogPin].end();
+    unsubscribe(analogPin);
+  }
+}
+
+size_t CFI_AnalogInputFeature::capturedSamples(byte analogPin)
+{
+  return analogPin < 16 ? _capture[analogPin].available() : 0;
+}
+
+size_t CFI_AnalogInputFeature::readSamples(byte analogPin, CFI_AnalogSample* samples, size_t count)
+{
+  return analogPin < 16 ? _capture[analogPin].read(samples, count) : 0;
+}
+
+uint32_t CFI_AnalogInputFeature::droppedSamples(byte analogPin)
+{
+  return analogPin < 16 ? _capture[analogPin].dropped() : 0;
+}
+
+// The export consumes the captured samples, they are written to the
+// file on every update
+bool CFI_AnalogInputFeature::beginExport(byte analogPin, const char* fileName, byte format)
+{
+  return analogPin < 16 && _capture[analogPin].beginExport(analogPin, fileName, format);
+}
+
+void CFI_AnalogInputFeature::endExport(byte analogPin)
+{
+  if (analogPin < 16) {
+    _capture[analogPin].endExport();
+  }
+}
+
+// Comparator interrupt: the output switches to above when the value
+// reaches the threshold and back to below when it falls under
+// threshold - hysteresis. The attached channel stays reported.
+void CFI_AnalogInputFeature::attachInterrupt(byte analogPin, int threshold, int hysteresis, int mode, void(*userFunc)(void))
+{
+  if (analogPin < 16 && userFunc != NULL) {
+    comparator_t& comparator = _comparators[analogPin];
+    if (comparator.func == NULL) {
+      subscribe(analogPin);
+    }
+    comparator.mode = mode;
+    comparator.threshold = threshold;
+    comparator.hysteresis = hysteresis < 0 ? 0 : hysteresis;
+    comparator.state = 255;
+    comparator.pending = false;
+    comparator.func = userFunc;
+  }
+}
+
+void CFI_AnalogInputFeature::detachInterrupt(byte analogPin)
+{
+  if (analogPin < 16 && _comparators[analogPin].func != NULL) {
+    _comparators[analogPin].func = NULL;
+    _comparators[analogPin].pending = false;
+    unsubscribe(analogPin);
+  }
+}
+
+void CFI_AnalogInputFeature::evaluateComparator(byte analogPin, int value)
+{
+  comparator_t& comparator = _comparators[analogPin];
+
+  byte state = comparator.state;
+  if (value >= comparator.threshold) {
+    state = 1;
+  } else if (value < comparator.threshold - comparator.hysteresis) {
+    state = 0;
+  }
+  if (comparator.state == 255) {
+    // first sample only initializes the comparator output
+    comparator.state = state;
+    return;
+  }
+
+  bool intTrigger = false;
+  switch (comparator.mode)
+  {
+  case CHANGE:
+    intTrigger = state != comparator.state;
+    break;
+  case FALLING:
+    intTrigger = state == 0 && comparator.state == 1;
+    break;
+  case RISING:
+    intTrigger = state == 1 && comparator.state == 0;
+    break;
+  default:
+    break;
+  }
+
+  comparator.state = state;
+  if (intTrigger) {
+    if (interruptsEnabled) {
+      comparator.func();
+    } else {
+      comparator.pending = true;
+    }
+  }
+}
+
+void CFI_AnalogInputFeature::interrupts()
+{
+  interruptsEnabled = true;
+
+  for (size_t i = 0; i < 16; i++) {
+    if (_comparators[i].func != NULL && _comparators[i].pending) {
+      _comparators[i].pending = false;
+      _comparators[i].func();
+    }
+  }
+}
+
+void CFI_AnalogInputFeature::noInterrupts()
+{
+  interruptsEnabled = false;
+}
+
+void CFI_AnalogInputFeature::reportAnalogPort(byte port, bool enable)
 {
   byte message[2];
 
   message[0] = (byte)(CFI_REPORT_ANALOG | port);
-  message[1] = 1;
+  message[1] = enable ? 1 : 0;
   _firmata->write(message, 2);
 
-  _reportPorts[port] = true;
+  _reportPorts[port] = enable;
+  _pendingPorts[port] = enable;
+}
+
+// Wait for the first sample after the report was switched on, so a read
+// after an idle period does not return the stale value.
+void CFI_AnalogInputFeature::waitForPortValue(byte port)
+{
+  unsigned long startMicros = micros();
+  while (_pendingPorts[port]) {
+    unsigned long elapsed = micros() - startMicros;
+    if (elapsed >= CFI_REPORT_RESUME_TIMEOUT * 1000UL) {
+      break;
+    }
+    _firmata->update();
+    if (_pendingPorts[port]) {
+      _firmata->waitForInput(CFI_REPORT_RESUME_TIMEOUT * 1000UL - elapsed);
+    }
+  }
 }
 
 int CFI_AnalogInputFeature::getPinValue(byte analogPin)
 {
   int value = 0;
   if (analogPin < 16) {
-    value = _analogPorts[analogPin];
+    _lastRead[analogPin] = millis();
+    _readCount++;
     if (!_reportPorts[analogPin]) {
       setPinMode(analogPin, CFI_PIN_MODE_ANALOG);
-      reportAnalogPort(analogPin);
+      reportAnalogPort(analogPin, true);
+      waitForPortValue(analogPin);
     }
+    value = _analogPorts[analogPin];
   }
   return value;
 }
@@ -66,4 +341,25 @@ boolean CFI_AnalogInputFeature::handleSysex(byte command, int argc, byte* argv)
 
 void CFI_AnalogInputFeature::updateFeature()
 {
+  for (byte port = 0; port < 16; port++) {
+    _capture[port].exportSamples();
+  }
+  if (_adaptiveSampling) {
+    adaptSamplingInterval();
+  }
+  if (_reportIdleTimeout == 0) {
+    return;
+  }
+  unsigned long now = millis();
+  for (byte port = 0; port < 16; port++) {
+    if (_reportPorts[port] && _subscribers[port] == 0 &&
+        now - _lastRead[port] >= _reportIdleTimeout) {
+      reportAnalogPort(port, false);
+    }
+  }
+}
+
+boolean CFI_AnalogInputFeature::handlesSysex(byte command)
+{
+  return false;
 }
@@ -15,6 +15,23 @@
 
 #include "CFI_ClientFirmata.h"
 #include "CFI_ClientFirmataFeature.h"
+#include "CFI_AnalogCapture.h"
+
+#if !defined(CFI_MIN_SAMPLING_INTERVAL)
+#define CFI_MIN_SAMPLING_INTERVAL 1 // ms, lower limit of the adaptive sampling interval
+#endif
+
+#if !defined(CFI_MAX_SAMPLING_INTERVAL)
+#define CFI_MAX_SAMPLING_INTERVAL 100 // ms, upper limit of the adaptive sampling interval
+#endif
+
+#if !defined(CFI_SAMPLING_ADAPT_PERIOD)
+#define CFI_SAMPLING_ADAPT_PERIOD 500 // ms between two adaptions of the sampling interval
+#endif
+
+#if !defined(CFI_SAMPLING_LINK_LOAD)
+#define CFI_SAMPLING_LINK_LOAD 50 // percent of the link bandwidth available for analog reports
+#endif
 
 class CFI_ClientFirmata;
 
@@ -27,15 +44,65 @@ class CFI_AnalogInputFeature: public CFI_ClientFirmataFeature
     int getPinValue(byte analogPin);
     void setAnalogPort(byte analogPin, int value);
 
+    void subscribe(byte analogPin);
+    void unsubscribe(byte analogPin);
+    void setReportIdleTimeout(unsigned long timeout);
+
+    void setSamplingInterval(unsigned int interval);
+    void setAdaptiveSampling(unsigned int minInterval = CFI_MIN_SAMPLING_INTERVAL,
+                             unsigned int maxInterval = CFI_MAX_SAMPLING_INTERVAL);
+
+    bool beginCapture(byte analogPin, size_t capacity = CFI_CAPTURE_BUFFER_SIZE);
+    void endCapture(byte analogPin);
+    size_t capturedSamples(byte analogPin);
+    size_t readSamples(byte analogPin, CFI_AnalogSample* samples, size_t count);
+    uint32_t droppedSamples(byte analogPin);
+    bool beginExport(byte analogPin, const char* fileName, byte format = CFI_CAPTURE_FORMAT_BINARY);
+    void endExport(byte analogPin);
+
+    void attachInterrupt(byte analogPin, int threshold, int hysteresis, int mode, void(*userFunc)(void));
+    void detachInterrupt(byte analogPin);
+    void interrupts();
+    void noInterrupts();
+
     boolean handleSysex(byte command, int argc, byte* argv);
     void updateFeature();
+    boolean handlesSysex(byte command);
 
   private:
     CFI_ClientFirmata *_firmata;
 	int _analogPorts[16] = { 0 }; // all analog input ports (one signal pin is one port)
+	byte _subscribers[16] = { 0 }; // number of consumers which keep the port reported
 	bool _reportPorts[16] = { 0 }; // 1 = report this port, 0 = silence
+	bool _pendingPorts[16] = { 0 }; // 1 = report switched on, no value received yet
+	unsigned long _lastRead[16] = { 0 }; // millis() of the last read access
+	unsigned long _reportIdleTimeout;
+	CFI_AnalogCapture _capture[16]; // opt-in sample buffers
+
+    typedef struct {
+        void (*func)(void);
+        int mode;
+        int threshold;
+        int hysteresis;
+        byte state; // comparator output: 0 = below, 1 = above, 255 = unknown
+        bool pending;
+    } comparator_t;
+
+    comparator_t _comparators[16];
+    volatile bool interruptsEnabled = true;
+
+    void evaluateComparator(byte analogPin, int value);
+
+    bool _adaptiveSampling;
+    unsigned int _minSamplingInterval;
+    unsigned int _maxSamplingInterval;
+    unsigned long _readCount; // reads since the last adaption
+    unsigned long _adaptStartMillis;
+    unsigned long _adaptStartBytes;
 
-    void reportAnalogPort(byte port);
+    void adaptSamplingInterval();
+    void reportAnalogPort(byte port, bool enable);
+    void waitForPortValue(byte port);
 };
 
 #endif
@@ -0,0 +1,696 @@
+/*
+  CFI_BoardSimulator.cpp - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#include "CFI_BoardSimulator.h"
+#include "CFI_ClientEncoder7Bit.h"
+#include "CFI_I2CFeature.h"
+#include "CFI_SPIFeature.h"
+
+#if defined(NUM_DIGITAL_PINS) && defined(NUM_ANALOG_INPUTS)
+#define CFI_SIM_BOARD_PINS NUM_DIGITAL_PINS
+#define CFI_SIM_BOARD_ANALOG_INPUTS NUM_ANALOG_INPUTS
+#else
+#define CFI_SIM_BOARD_PINS 20
+#define CFI_SIM_BOARD_ANALOG_INPUTS 6
+#endif
+
+#define CFI_SIM_FIRMWARE_NAME "BoardSimulator"
+
+//******************************************************************************
+//* CFI_SimulatedRegisters
+//******************************************************************************
+
+CFI_SimulatedRegisters::CFI_SimulatedRegisters() : _pointer(0)
+{
+    memset(_registers, 0, sizeof(_registers));
+}
+
+void CFI_SimulatedRegisters::i2cWrite(const byte* data, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    _pointer = data[0];
+    for (size_t i = 1; i < count; i++) {
+        _registers[_pointer++] = data[i];
+    }
+}
+
+void CFI_SimulatedRegisters::i2cRead(int reg, byte* data, size_t count)
+{
+    if (reg >= 0) {
+        _pointer = (byte)reg;
+    }
+    for (size_t i = 0; i < count; i++) {
+        data[i] = _registers[_pointer++];
+    }
+}
+
+void CFI_SimulatedRegisters::spiTransfer(byte* data, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    bool isRead = (data[0] & 0x80) != 0;
+    _pointer = data[0] & 0x7F;
+    data[0] = 0;
+    for (size_t i = 1; i < count; i++) {
+        if (isRead) {
+            data[i] = _registers[_pointer++];
+        }
+        else {
+            _registers[_pointer++] = data[i];
+            data[i] = 0;
+        }
+    }
+}
+
+//******************************************************************************
+//* CFI_BoardSimulator
+//******************************************************************************
+
+CFI_BoardSimulator::CFI_BoardSimulator() : _byteMicros(0), _bytesToHost(0), _bytesFromHost(0), _overflows(0)
+{
+    memset(&_toHost, 0, sizeof(_toHost));
+    memset(&_fromHost, 0, sizeof(_fromHost));
+    memset(_i2cDevices, 0, sizeof(_i2cDevices));
+    memset(_spiDevices, 0, sizeof(_spiDevices));
+    memset(_pinLevel, 0, sizeof(_pinLevel));
+    memset(_analogInput, 0, sizeof(_analogInput));
+    reset();
+}
+
+void CFI_BoardSimulator::begin(unsigned long baudRate)
+{
+    // 10 bits per byte on the wire
+    _byteMicros = baudRate > 0 ? (10000000ul + baudRate - 1) / baudRate : 0;
+}
+
+// Power up state of StandardFirmata, the inputs keep their levels
+void CFI_BoardSimulator::reset()
+{
+    _command = 0;
+    _waitForData = 0;
+    _parsingSysex = false;
+    _sysexSize = 0;
+
+    for (int pin = 0; pin < CFI_SIM_TOTAL_PINS; pin++) {
+        _pinMode[pin] = (pin >= A0 && pin < A0 + CFI_SIM_BOARD_ANALOG_INPUTS) ? CFI_PIN_MODE_ANALOG : CFI_PIN_MODE_OUTPUT;
+        _pinValue[pin] = 0;
+    }
+    memset(_reportPorts, 0, sizeof(_reportPorts));
+    memset(_lastPorts, 0, sizeof(_lastPorts));
+    memset(_spiChipSelect, 0, sizeof(_spiChipSelect));
+    _reportChannels = 0;
+    _i2cQueryCount = 0;
+    _samplingInterval = CFI_DEFAULT_SAMPLING_INTERVAL;
+    _lastSample = micros();
+}
+
+//------------------------------------------------------------------------------
+// Simulated link
+
+bool CFI_BoardSimulator::enqueue(linkQueue_t& queue, byte data)
+{
+    if (queue.count == CFI_SIM_BUFFER_SIZE) {
+        _overflows++;
+        return false;
+    }
+    unsigned long now = micros();
+    if (queue.count == 0 || (long)(now - queue.linkFree) > 0) {
+        queue.linkFree = now;
+    }
+    queue.linkFree += _byteMicros;
+
+    linkByte_t& entry = queue.bytes[(queue.head + queue.count) % CFI_SIM_BUFFER_SIZE];
+    entry.data = data;
+    entry.ready = queue.linkFree;
+    queue.count++;
+    return true;
+}
+
+// Number of queued bytes which have passed the link
+size_t CFI_BoardSimulator::arrived(linkQueue_t& queue)
+{
+    if (_byteMicros == 0) {
+        return queue.count;
+    }
+    unsigned long now = micros();
+    size_t count = 0;
+    while (count < queue.count &&
+           (long)(now - queue.bytes[(queue.head + count) % CFI_SIM_BUFFER_SIZE].ready) >= 0) {
+        count++;
+    }
+    return count;
+}
+
+// Lets the board handle the arrived messages and send its reports
+void CFI_BoardSimulator::run()
+{
+    for (size_t n = arrived(_fromHost); n > 0; n--) {
+        byte value = _fromHost.bytes[_fromHost.head].data;
+        _fromHost.head = (_fromHost.head + 1) % CFI_SIM_BUFFER_SIZE;
+        _fromHost.count--;
+        parse(value);
+    }
+
+    for (byte port = 0; port < 16; port++) {
+        if (_reportPorts[port] && readPort(port) != _lastPorts[port]) {
+            sendPort(port);
+        }
+    }
+
+    unsigned long now = micros();
+    unsigned long interval = _samplingInterval * 1000ul;
+    if (now - _lastSample >= interval) {
+        // a stalled host gets the current values, not a burst of old ones
+        _lastSample = (now - _lastSample >= 10 * interval) ? now : _lastSample + interval;
+        for (byte channel = 0; channel < CFI_SIM_ANALOG_CHANNELS; channel++) {
+            if (_reportChannels & (1 << channel)) {
+                sendAnalog(channel);
+            }
+        }
+        for (byte i = 0; i < _i2cQueryCount; i++) {
+            sendI2CReply(_i2cQueries[i].address, _i2cQueries[i].reg, _i2cQueries[i].count);
+        }
+    }
+}
+
+void CFI_BoardSimulator::send(const byte* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (enqueue(_toHost, data[i])) {
+            _bytesToHost++;
+        }
+    }
+}
+
+void CFI_BoardSimulator::sendSysex(byte command, const byte* data, size_t size)
+{
+    byte header[2] = { (byte)CFI_START_SYSEX, command };
+    byte footer = CFI_END_SYSEX;
+    send(header, 2);
+    send(data, size);
+    send(&footer, 1);
+}
+
+void CFI_BoardSimulator::sendPort(byte port)
+{
+    byte value = readPort(port);
+    byte message[3] = { (byte)(CFI_DIGITAL_MESSAGE | port), (byte)(value & 0x7F), (byte)(value >> 7) };
+    _lastPorts[port] = value;
+    send(message, 3);
+}
+
+void CFI_BoardSimulator::sendAnalog(byte channel)
+{
+    int value = _analogInput[channel];
+    byte message[3] = { (byte)(CFI_ANALOG_MESSAGE | channel), (byte)(value & 0x7F), (byte)((value >> 7) & 0x7F) };
+    send(message, 3);
+}
+
+void CFI_BoardSimulator::sendI2CReply(byte address, int reg, byte count)
+{
+    byte data[MAX_I2C_BUF_SIZE];
+    byte reply[4 + 2 * MAX_I2C_BUF_SIZE];
+    count = min(count, (byte)MAX_I2C_BUF_SIZE);
+    memset(data, 0, sizeof(data));
+
+    CFI_SimulatedDevice* device = findDevice(_i2cDevices, address);
+    if (device != NULL) {
+        device->i2cRead(reg, data, count);
+    }
+    reply[0] = address & 0x7F;
+    reply[1] = (address >> 7) & 0x7F;
+    reply[2] = reg & 0x7F;
+    reply[3] = (reg >> 7) & 0x7F;
+    for (byte i = 0; i < count; i++) {
+        reply[4 + 2 * i] = data[i] & 0x7F;
+        reply[5 + 2 * i] = data[i] >> 7;
+    }
+    sendSysex(CFI_I2C_REPLY, reply, 4 + 2 * count);
+}
+
+//------------------------------------------------------------------------------
+// Stream
+
+int CFI_BoardSimulator::available()
+{
+    run();
+    return (int)arrived(_toHost);
+}
+
+int CFI_BoardSimulator::read()
+{
+    if (available() == 0) {
+        return -1;
+    }
+    byte value = _toHost.bytes[_toHost.head].data;
+    _toHost.head = (_toHost.head + 1) % CFI_SIM_BUFFER_SIZE;
+    _toHost.count--;
+    return value;
+}
+
+int CFI_BoardSimulator::peek()
+{
+    if (available() == 0) {
+        return -1;
+    }
+    return _toHost.bytes[_toHost.head].data;
+}
+
+// Waits until the board has received all written bytes
+void CFI_BoardSimulator::flush()
+{
+    while (_fromHost.count > 0) {
+        run();
+    }
+}
+
+size_t CFI_BoardSimulator::write(uint8_t b)
+{
+    return write(&b, 1);
+}
+
+size_t CFI_BoardSimulator::write(const uint8_t* buffer, size_t size)
+{
+    size_t bytes = 0;
+    while (bytes < size) {
+        if (_fromHost.count == CFI_SIM_BUFFER_SIZE) {
+            // like a blocking UART write, wait for the link to drain
+            run();
+            continue;
+        }
+        enqueue(_fromHost, buffer[bytes++]);
+        _bytesFromHost++;
+    }
+    return bytes;
+}
+
+//------------------------------------------------------------------------------
+// Simulated hardware
+
+void CFI_BoardSimulator::setDigitalInput(byte pin, bool level)
+{
+    if (pin < CFI_SIM_TOTAL_PINS) {
+        _pinLevel[pin] = level;
+    }
+}
+
+void CFI_BoardSimulator::setAnalogInput(byte channel, int value)
+{
+    if (channel < CFI_SIM_ANALOG_CHANNELS) {
+        _analogInput[channel] = value;
+    }
+}
+
+byte CFI_BoardSimulator::getPinMode(byte pin)
+{
+    return pin < CFI_SIM_TOTAL_PINS ? _pinMode[pin] : CFI_PIN_MODE_IGNORE;
+}
+
+bool CFI_BoardSimulator::getDigitalOutput(byte pin)
+{
+    return pin < CFI_SIM_TOTAL_PINS && _pinMode[pin] == CFI_PIN_MODE_OUTPUT && _pinLevel[pin];
+}
+
+int CFI_BoardSimulator::getAnalogOutput(byte pin)
+{
+    return pin < CFI_SIM_TOTAL_PINS ? _pinValue[pin] : 0;
+}
+
+void CFI_BoardSimulator::attachI2C(byte address, CFI_SimulatedDevice& device)
+{
+    for (byte i = 0; i < CFI_SIM_MAX_DEVICES; i++) {
+        if (_i2cDevices[i].device == NULL || _i2cDevices[i].address == address) {
+            _i2cDevices[i].address = address;
+            _i2cDevices[i].device = &device;
+            return;
+        }
+    }
+}
+
+void CFI_BoardSimulator::attachSPI(byte csPin, CFI_SimulatedDevice& device)
+{
+    for (byte i = 0; i < CFI_SIM_MAX_DEVICES; i++) {
+        if (_spiDevices[i].device == NULL || _spiDevices[i].address == csPin) {
+            _spiDevices[i].address = csPin;
+            _spiDevices[i].device = &device;
+            return;
+        }
+    }
+}
+
+CFI_SimulatedDevice* CFI_BoardSimulator::findDevice(device_t* devices, byte address)
+{
+    for (byte i = 0; i < CFI_SIM_MAX_DEVICES && devices[i].device != NULL; i++) {
+        if (devices[i].address == address) {
+            return devices[i].device;
+        }
+    }
+    return NULL;
+}
+
+byte CFI_BoardSimulator::readPort(byte port)
+{
+    byte value = 0;
+    for (byte i = 0; i < 8; i++) {
+        byte pin = port * 8 + i;
+        if (pin < CFI_SIM_TOTAL_PINS && _pinLevel[pin] &&
+            (_pinMode[pin] == CFI_PIN_MODE_INPUT || _pinMode[pin] == CFI_PIN_MODE_PULLUP)) {
+            value |= 1 << i;
+        }
+    }
+    return value;
+}
+
+void CFI_BoardSimulator::writePin(byte pin, bool level)
+{
+    if (pin < CFI_SIM_TOTAL_PINS && _pinMode[pin] == CFI_PIN_MODE_OUTPUT) {
+        _pinLevel[pin] = level;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Board side message handling
+
+void CFI_BoardSimulator::parse(byte value)
+{
+    if (_parsingSysex) {
+        if (value == CFI_END_SYSEX) {
+            _parsingSysex = false;
+            if (_sysexSize > 0) {
+                executeSysex(_sysex[0], _sysex + 1, _sysexSize - 1);
+            }
+            return;
+        }
+        if (value < 0x80) {
+            if (_sysexSize < CFI_SIM_SYSEX_SIZE) {
+                _sysex[_sysexSize++] = value;
+            }
+            return;
+        }
+        // a command byte ends a malformed sysex message
+        _parsingSysex = false;
+    }
+
+    if (value < 0x80) {
+        if (_waitForData > 0) {
+            _data[2 - _waitForData] = value;
+            if (--_waitForData == 0) {
+                execute(_command, _channel, _data);
+            }
+        }
+        return;
+    }
+
+    _waitForData = 0;
+    _command = value < 0xF0 ? value & 0xF0 : value;
+    _channel = value & 0x0F;
+    switch (_command) {
+    case CFI_DIGITAL_MESSAGE:
+    case CFI_ANALOG_MESSAGE:
+    case CFI_SET_PIN_MODE:
+    case CFI_SET_DIGITAL_PIN_VALUE:
+        _waitForData = 2;
+        break;
+    case CFI_REPORT_ANALOG:
+    case CFI_REPORT_DIGITAL:
+        _waitForData = 1;
+        _data[1] = 0;
+        break;
+    case CFI_START_SYSEX:
+        _parsingSysex = true;
+        _sysexSize = 0;
+        break;
+    case CFI_REPORT_VERSION:
+        execute(_command, 0, _data);
+        break;
+    case CFI_SYSTEM_RESET:
+        reset();
+        break;
+    default:
+        break;
+    }
+}
+
+void CFI_BoardSimulator::execute(byte command, byte channel, const byte* data)
+{
+    switch (command) {
+    case CFI_DIGITAL_MESSAGE:
+    {
+        int value = data[0] | (data[1] << 7);
+        for (byte i = 0; i < 8; i++) {
+            writePin(channel * 8 + i, (value >> i) & 0x01);
+        }
+        break;
+    }
+    case CFI_ANALOG_MESSAGE:
+        _pinValue[channel] = data[0] | (data[1] << 7);
+        break;
+    case CFI_REPORT_ANALOG:
+        if (data[0]) {
+            _reportChannels |= 1 << channel;
+            sendAnalog(channel);
+        }
+        else {
+            _reportChannels &= ~(1 << channel);
+        }
+        break;
+    case CFI_REPORT_DIGITAL:
+        _reportPorts[channel] = data[0] ? 1 : 0;
+        if (data[0]) {
+            sendPort(channel);
+        }
+        break;
+    case CFI_SET_PIN_MODE:
+        if (data[0] < CFI_SIM_TOTAL_PINS) {
+            if (data[1] == CFI_PIN_MODE_PULLUP && _pinMode[data[0]] != CFI_PIN_MODE_PULLUP) {
+                // an open input reads HIGH with the pull-up
+                _pinLevel[data[0]] = true;
+            }
+            _pinMode[data[0]] = data[1];
+        }
+        break;
+    case CFI_SET_DIGITAL_PIN_VALUE:
+        writePin(data[0], data[1] != 0);
+        break;
+    case CFI_REPORT_VERSION:
+    {
+        byte message[3] = { (byte)CFI_REPORT_VERSION, 2, 5 };
+        send(message, 3);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void CFI_BoardSimulator::executeSysex(byte command, const byte* data, size_t size)
+{
+    switch (command) {
+    case CFI_REPORT_FIRMWARE:
+    {
+        const char* name = CFI_SIM_FIRMWARE_NAME;
+        byte reply[2 + 2 * sizeof(CFI_SIM_FIRMWARE_NAME)];
+        size_t length = 0;
+        reply[length++] = 2;
+        reply[length++] = 5;
+        for (; *name != '\0'; name++) {
+            reply[length++] = *name & 0x7F;
+            reply[length++] = (*name >> 7) & 0x7F;
+        }
+        sendSysex(CFI_REPORT_FIRMWARE, reply, length);
+        break;
+    }
+    case CFI_SAMPLING_INTERVAL:
+        if (size >= 2) {
+            _samplingInterval = max(data[0] | (data[1] << 7), 1);
+        }
+        break;
+    case CFI_EXTENDED_ANALOG:
+        if (size >= 2 && data[0] < CFI_SIM_TOTAL_PINS) {
+            int value = 0;
+            for (size_t i = 1; i < size && i < 5; i++) {
+                value |= data[i] << (7 * (i - 1));
+            }
+            _pinValue[data[0]] = value;
+        }
+        break;
+    case CFI_CAPABILITY_QUERY:
+    {
+        byte reply[CFI_SIM_BOARD_PINS * 9];
+        size_t length = 0;
+        for (int pin = 0; pin < CFI_SIM_BOARD_PINS; pin++) {
+            reply[length++] = CFI_PIN_MODE_INPUT;
+            reply[length++] = 1;
+            reply[length++] = CFI_PIN_MODE_OUTPUT;
+            reply[length++] = 1;
+            reply[length++] = CFI_PIN_MODE_PULLUP;
+            reply[length++] = 1;
+            if (pin >= A0 && pin < A0 + CFI_SIM_BOARD_ANALOG_INPUTS) {
+                reply[length++] = CFI_PIN_MODE_ANALOG;
+                reply[length++] = 10;
+            }
+            reply[length++] = 0x7F;
+        }
+        sendSysex(CFI_CAPABILITY_RESPONSE, reply, length);
+        break;
+    }
+    case CFI_ANALOG_MAPPING_QUERY:
+    {
+        byte reply[CFI_SIM_BOARD_PINS];
+        for (int pin = 0; pin < CFI_SIM_BOARD_PINS; pin++) {
+            reply[pin] = (pin >= A0 && pin < A0 + CFI_SIM_BOARD_ANALOG_INPUTS) ? pin - A0 : 0x7F;
+        }
+        sendSysex(CFI_ANALOG_MAPPING_RESPONSE, reply, CFI_SIM_BOARD_PINS);
+        break;
+    }
+    case CFI_PIN_STATE_QUERY:
+        if (size >= 1 && data[0] < CFI_SIM_TOTAL_PINS) {
+            byte pin = data[0];
+            int state = _pinMode[pin] == CFI_PIN_MODE_OUTPUT || _pinMode[pin] == CFI_PIN_MODE_INPUT ||
+                        _pinMode[pin] == CFI_PIN_MODE_PULLUP ? _pinLevel[pin] : _pinValue[pin];
+            byte reply[4] = { pin, _pinMode[pin], (byte)(state & 0x7F), (byte)((state >> 7) & 0x7F) };
+            sendSysex(CFI_PIN_STATE_RESPONSE, reply, 4);
+        }
+        break;
+    case CFI_I2C_REQUEST:
+        executeI2C(data, size);
+        break;
+    case CFI_SPI_DATA:
+        executeSPI(data, size);
+        break;
+    default:
+        // I2C_CONFIG and all not simulated features
+        break;
+    }
+}
+
+void CFI_BoardSimulator::executeI2C(const byte* data, size_t size)
+{
+    if (size < 2) {
+        return;
+    }
+    byte address = data[0];
+    byte mode = (data[1] >> 3) & 0x03;
+    const byte* args = data + 2;
+    size_t argc = (size - 2) / 2;
+
+    switch (mode) {
+    case CFI_I2C_WRITE:
+    {
+        byte values[CFI_SIM_SYSEX_SIZE / 2];
+        for (size_t i = 0; i < argc; i++) {
+            values[i] = args[2 * i] | (args[2 * i + 1] << 7);
+        }
+        CFI_SimulatedDevice* device = findDevice(_i2cDevices, address);
+        if (device != NULL) {
+            device->i2cWrite(values, argc);
+        }
+        break;
+    }
+    case CFI_I2C_READ:
+    case CFI_I2C_READ_CONTINUOUSLY:
+    {
+        int reg = CFI_I2C_REGISTER_NOT_SPECIFIED;
+        byte count = 0;
+        if (argc >= 2) {
+            reg = args[0] | (args[1] << 7);
+            count = args[2] | (args[3] << 7);
+        }
+        else if (argc == 1) {
+            count = args[0] | (args[1] << 7);
+        }
+        if (mode == CFI_I2C_READ) {
+            sendI2CReply(address, reg, count);
+        }
+        else if (_i2cQueryCount < CFI_SIM_MAX_DEVICES) {
+            _i2cQueries[_i2cQueryCount++] = { address, reg, count };
+        }
+        break;
+    }
+    case CFI_I2C_STOP_READING:
+        for (byte i = 0; i < _i2cQueryCount; i++) {
+            if (_i2cQueries[i].address == address) {
+                _i2cQueries[i] = _i2cQueries[--_i2cQueryCount];
+                break;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void CFI_BoardSimulator::executeSPI(const byte* data, size_t size)
+{
+    if (size < 2) {
+        return;
+    }
+    byte deviceId = (data[1] >> 3) & 0x0F;
+
+    switch (data[0]) {
+    case SPI_DEVICE_CONFIG:
+        if (size >= 11) {
+            _spiChipSelect[deviceId] = data[10];
+        }
+        break;
+    case SPI_TRANSFER:
+    case SPI_WRITE:
+    case SPI_READ:
+    {
+        if (size < 5) {
+            return;
+        }
+        byte numWords = min(data[4], (byte)MAX_SPI_BUF_SIZE);
+        byte words[MAX_SPI_BUF_SIZE];
+        memset(words, 0, sizeof(words));
+        if (data[0] != SPI_READ && size >= 5 + (numWords * 8 + 6) / 7) {
+            CFI_ClientEncoder7BitClass::readBinary(numWords, (byte*)data + 5, words);
+        }
+
+        // the chip select pin of the device configuration, else a device selected by the sketch
+        CFI_SimulatedDevice* device = findDevice(_spiDevices, _spiChipSelect[deviceId]);
+        for (byte i = 0; device == NULL && i < CFI_SIM_MAX_DEVICES && _spiDevices[i].device != NULL; i++) {
+            byte csPin = _spiDevices[i].address;
+            if (csPin < CFI_SIM_TOTAL_PINS && _pinMode[csPin] == CFI_PIN_MODE_OUTPUT && !_pinLevel[csPin]) {
+                device = _spiDevices[i].device;
+            }
+        }
+        if (device != NULL) {
+            device->spiTransfer(words, numWords);
+        }
+        if (data[0] == SPI_WRITE) {
+            break;
+        }
+
+        byte reply[4 + (MAX_SPI_BUF_SIZE * 8 + 6) / 7];
+        size_t length = 0;
+        reply[length++] = SPI_REPLY;
+        reply[length++] = data[1];
+        reply[length++] = data[2];
+        reply[length++] = numWords;
+        CFI_ClientEncoder7BitClass encoder;
+        encoder.startBinaryWrite(reply, (int)length);
+        for (byte i = 0; i < numWords; i++) {
+            encoder.writeBinary(words[i]);
+        }
+        length = encoder.endBinaryWrite();
+        sendSysex(CFI_SPI_DATA, reply, length);
+        break;
+    }
+    default:
+        // SPI_BEGIN, SPI_END
+        break;
+    }
+}
@@ -0,0 +1,184 @@
+/*
+  CFI_BoardSimulator.h - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#ifndef CFI_BoardSimulator_h
+#define CFI_BoardSimulator_h
+
+#include "Stream.h"
+#include "CFI_FirmataDefines.h"
+
+#define CFI_SIM_TOTAL_PINS 128 // pin numbers a Firmata message can address
+#define CFI_SIM_ANALOG_CHANNELS 16
+
+#if !defined(CFI_SIM_BUFFER_SIZE)
+#define CFI_SIM_BUFFER_SIZE 1024 // bytes in flight on each direction of the simulated link
+#endif
+
+#if !defined(CFI_SIM_MAX_DEVICES)
+#define CFI_SIM_MAX_DEVICES 8
+#endif
+
+#if !defined(CFI_SIM_SYSEX_SIZE)
+#define CFI_SIM_SYSEX_SIZE 64 // sysex buffer of the simulated board, like StandardFirmata on an AVR
+#endif
+
+// A device on the I2C or SPI bus of the simulated board
+class CFI_SimulatedDevice
+{
+public:
+    virtual ~CFI_SimulatedDevice() {}
+
+    // I2C write transfer
+    virtual void i2cWrite(const byte* data, size_t count) {}
+    // I2C read transfer, reg is -1 if the request did not specify a register
+    virtual void i2cRead(int reg, byte* data, size_t count) {}
+    // SPI transfer while the chip select pin is low, exchanges the bytes in place
+    virtual void spiTransfer(byte* data, size_t count) {}
+};
+
+// Register map with auto increment, the common model of I2C and SPI sensors.
+// I2C: the first byte written selects the register. SPI: the first byte selects
+// the register, bit 7 set reads, cleared writes the following bytes.
+class CFI_SimulatedRegisters : public CFI_SimulatedDevice
+{
+public:
+    CFI_SimulatedRegisters();
+
+    void setRegister(byte reg, byte value) { _registers[reg] = value; }
+    byte getRegister(byte reg) const { return _registers[reg]; }
+
+    void i2cWrite(const byte* data, size_t count);
+    void i2cRead(int reg, byte* data, size_t count);
+    void spiTransfer(byte* data, size_t count);
+
+private:
+    byte _registers[256];
+    byte _pointer;
+};
+
+// A Firmata board simulated in the process, usable as the stream of
+// CFI_ClientFirmata::begin(). It models the pin states, the analog and digital
+// reports at the sampling interval, I2C and SPI devices and the bandwidth of
+// a UART link. The board runs whenever the client accesses the stream.
+class CFI_BoardSimulator : public Stream
+{
+public:
+    CFI_BoardSimulator();
+
+    // baudRate 0 runs the link at full speed
+    void begin(unsigned long baudRate);
+
+    /* Stream */
+    int available();
+    int read();
+    int peek();
+    void flush();
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buffer, size_t size);
+
+    using Print::write; // pull in write(str) and write(buf, size) from Print
+
+    /* simulated hardware */
+    void setDigitalInput(byte pin, bool level);
+    void setAnalogInput(byte channel, int value);
+    byte getPinMode(byte pin);
+    bool getDigitalOutput(byte pin);
+    int getAnalogOutput(byte pin);
+    void attachI2C(byte address, CFI_SimulatedDevice& device);
+    void attachSPI(byte csPin, CFI_SimulatedDevice& device);
+    unsigned int getSamplingInterval() { return _samplingInterval; }
+
+    /* link statistics */
+    unsigned long bytesToHost() { return _bytesToHost; }
+    unsigned long bytesFromHost() { return _bytesFromHost; }
+    unsigned long overflows() { return _overflows; }
+
+private:
+    typedef struct {
+        byte data;
+        unsigned long ready; // micros when the byte has passed the link
+    } linkByte_t;
+
+    typedef struct {
+        linkByte_t bytes[CFI_SIM_BUFFER_SIZE];
+        size_t head;
+        size_t count;
+        unsigned long linkFree; // micros when the last queued byte has passed the link
+    } linkQueue_t;
+
+    typedef struct {
+        byte address; // I2C address or SPI chip select pin
+        CFI_SimulatedDevice* device;
+    } device_t;
+
+    typedef struct {
+        byte address;
+        int reg;
+        byte count;
+    } i2cQuery_t;
+
+    void run();
+    void reset();
+    bool enqueue(linkQueue_t& queue, byte data);
+    size_t arrived(linkQueue_t& queue);
+    void send(const byte* data, size_t size);
+    void sendSysex(byte command, const byte* data, size_t size);
+    void sendPort(byte port);
+    void sendAnalog(byte channel);
+    void sendI2CReply(byte address, int reg, byte count);
+
+    void parse(byte value);
+    void execute(byte command, byte channel, const byte* data);
+    void executeSysex(byte command, const byte* data, size_t size);
+    void executeI2C(const byte* data, size_t size);
+    void executeSPI(const byte* data, size_t size);
+    void writePin(byte pin, bool level);
+
+    CFI_SimulatedDevice* findDevice(device_t* devices, byte address);
+    byte readPort(byte port);
+
+    unsigned long _byteMicros;
+    linkQueue_t _toHost;
+    linkQueue_t _fromHost;
+    unsigned long _bytesToHost;
+    unsigned long _bytesFromHost;
+    unsigned long _overflows;
+
+    /* board parser */
+    byte _command;
+    byte _channel;
+    byte _waitForData;
+    byte _data[2];
+    bool _parsingSysex;
+    byte _sysex[CFI_SIM_SYSEX_SIZE];
+    size_t _sysexSize;
+
+    /* pins */
+    byte _pinMode[CFI_SIM_TOTAL_PINS];
+    bool _pinLevel[CFI_SIM_TOTAL_PINS];
+    int _pinValue[CFI_SIM_TOTAL_PINS];
+    int _analogInput[CFI_SIM_ANALOG_CHANNELS];
+    byte _reportPorts[16];
+    byte _lastPorts[16];
+    uint16_t _reportChannels;
+
+    unsigned int _samplingInterval;
+    unsigned long _lastSample;
+
+    device_t _i2cDevices[CFI_SIM_MAX_DEVICES];
+    device_t _spiDevices[CFI_SIM_MAX_DEVICES];
+    byte _spiChipSelect[16]; // chip select pin of each configured SPI device id
+    i2cQuery_t _i2cQueries[CFI_SIM_MAX_DEVICES];
+    byte _i2cQueryCount;
+};
+
+#endif
@@ -15,6 +15,9 @@
 //******************************************************************************
 
 #include "CFI_ClientFirmata.h"
+#include "Udp.h"
+
+#include <algorithm>
 
 extern "C" {
 #include <string.h>
@@ -40,6 +43,8 @@ void CFI_ClientFirmata::sendValueAsTwo7bitBytes(int value)
  */
 void CFI_ClientFirmata::startSysex(void)
 {
+  // released by endSysex(), the message is not interleaved with another thread's
+  _ioMutex.lock();
   write(CFI_START_SYSEX);
 }
 
@@ -52,6 +57,7 @@ void CFI_ClientFirmata::endSysex(void)
 #if defined(WIN32) && defined(_DEBUG)
   _stream->flush();
 #endif
+  _ioMutex.unlock();
 }
 
 //******************************************************************************
@@ -66,9 +72,37 @@ CFI_ClientFirmata::CFI_ClientFirmata()
   currentStringCallback = NULL;
   currentSystemResetCallback = NULL;
   parsingSysex = false;
+  skippingSysex = false;
   waitForData = 0;
   resetting = false;
   numFeatures = 0;
+  _numUpdateFeatures = 0;
+  memset(_sysexHandlers, 0, sizeof(_sysexHandlers));
+  _digitalInput = NULL;
+  _analogInput = NULL;
+  _samplingInterval = CFI_DEFAULT_SAMPLING_INTERVAL;
+  _linkBaudRate = 0;
+  _bytesReceived = 0;
+  _bytesSent = 0;
+  _messagesSent = 0;
+  _messagesReceived = 0;
+  _parseErrors = 0;
+  _sysexOverflows = 0;
+  _writeStalls = 0;
+  _bytesDropped = 0;
+  memset(_lastRates, 0, sizeof(_lastRates));
+  memset(_rates, 0, sizeof(_rates));
+  _ratesMillis = 0;
+  _probeInterval = 0;
+  _probeMicros = 0;
+  _probeMillis = 0;
+  _probePending = false;
+  _probesSent = 0;
+  _probesLost = 0;
+  _roundTripCount = 0;
+  _roundTripNext = 0;
+  _stream = NULL;
+  _reports = NULL;
 
   memset(_instanceTable, 0, sizeof(_instanceTable));
 }
@@ -86,6 +120,7 @@ CFI_ClientFirmata::CFI_ClientFirmata()
 void CFI_ClientFirmata::begin(Stream &s)
 {
   _stream = &s;
+  _ratesMillis = millis();
 
   // systemReset();
   resetting = true;
@@ -95,18 +130,44 @@ void CFI_ClientFirmata::begin(Stream &s)
 #endif
 }
 
+/**
+ * Assign an additional datagram transport for reports, e.g. the analog and digital
+ * reports of a network board. Each datagram carries complete messages, so a lost one
+ * only loses these messages and never breaks the parsing of the stream transport.
+ * @param udp A reference to the UDP object, already listening on its port.
+ */
+void CFI_ClientFirmata::beginReports(UDP& udp)
+{
+  _reports = &udp;
+}
+
 void CFI_ClientFirmata::update()
 {
+  std::lock_guard<std::recursive_mutex> lock(_ioMutex);
+  updateStatistics();
   updateFeatures();
   for (size_t i = available(); i > 0; i--) {
     processInput();
   }
+  if (_reports != NULL && !isParsingMessage()) {
+    processReports();
+  }
 }
 
 void CFI_ClientFirmata::addFeature(CFI_ClientFirmataFeature& capability)
 {
-  if (numFeatures < CFI_MAX_FEATURES) {
-    features[numFeatures++] = &capability;
+  if (numFeatures == CFI_MAX_FEATURES) {
+    return;
+  }
+  // route each sysex command only to the features handling it
+  for (byte command = 0; command < 128; command++) {
+    if (capability.handlesSysex(command)) {
+      _sysexHandlers[command] |= 1UL << numFeatures;
+    }
+  }
+  features[numFeatures++] = &capability;
+  if (capability.hasUpdate()) {
+    _updateFeatures[_numUpdateFeatures++] = &capability;
   }
 }
 
@@ -146,9 +207,37 @@ byte CFI_ClientFirmata::nextInstanceNumber(byte classId)
  */
 int CFI_ClientFirmata::available(void)
 {
+  std::lock_guard<std::recursive_mutex> lock(_ioMutex);
   return _stream->available();
 }
 
+/**
+ * Sleeps until input is available or the timeout elapsed, so waiting
+ * features do not spin on update().
+ * @param timeout Maximum wait in microseconds.
+ */
+void CFI_ClientFirmata::waitForInput(unsigned long timeout)
+{
+  {
+    std::lock_guard<std::recursive_mutex> lock(_ioMutex);
+    if (_stream->available() > 0) {
+      return;
+    }
+    // streams which can sleep until input arrives; at most 1 ms, the
+    // interrupt thread waits for the lock meanwhile and the callers loop
+    unsigned long start = micros();
+    if (_stream->waitAvailable(timeout >= 1000 ? 1 : 0) || micros() - start >= 1000) {
+      return;
+    }
+  }
+  if (timeout >= 1000) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  else {
+    std::this_thread::yield();
+  }
+}
+
 void CFI_ClientFirmata::two7bitArrayToStr(unsigned char *buffer, byte sysexBytesLength)
 {
   byte bufferLength = sysexBytesLength / 2;
@@ -208,10 +297,34 @@ void CFI_ClientFirmata::processInput(void)
 {
   int inputData = _stream->read(); // this is 'int' to handle -1 when no data
   if (inputData != -1) {
+    _bytesReceived++;
     parse(inputData);
   }
 }
 
+/**
+ * Parse all received report datagrams. Called only between two messages of the
+ * stream transport, the parser is reset after each datagram.
+ */
+void CFI_ClientFirmata::processReports(void)
+{
+  while (_reports->parsePacket() > 0) {
+    int inputData;
+    while ((inputData = _reports->read()) != -1) {
+      _bytesReceived++;
+      parse(inputData);
+    }
+    // drop the rest of a truncated message
+    if (isParsingMessage()) {
+      _parseErrors++;
+    }
+    parsingSysex = false;
+    skippingSysex = false;
+    waitForData = 0;
+    executeMultiByteCommand = 0;
+  }
+}
+
 /**
  * Parse data from the input stream.
  * @param inputData A single byte to be added to the parser.
@@ -220,6 +333,18 @@ void CFI_ClientFirmata::parse(byte inputData)
 {
   int command;
 
+  if (skippingSysex) {
+    // the rest of an overflowed sysex message, already counted
+    if (inputData <= 0x7F) {
+      return;
+    }
+    skippingSysex = false;
+    if (inputData == CFI_END_SYSEX) {
+      return;
+    }
+    // a command byte ends the message early, parse it below
+  }
+
   if (parsingSysex) {
     if (inputData == CFI_END_SYSEX) {
       //stop sysex byte
@@ -228,22 +353,25 @@ void CFI_ClientFirmata::parse(byte inputData)
       processSysexMessage();
     } else if (inputData > 127) {
       // malformed SYSEX telegram, stop parsing
+      _parseErrors++;
       parsingSysex = false;
     } else {
       // check for length of SYSEX telegram
       if (sysexBytesRead == CFI_CLIENT_MAX_DATA_BYTES) {
-        // malformed SYSEX telegram, stop parsing
+        // SYSEX telegram too long, drop the rest up to END_SYSEX
         CFI_DEBUG_PRINT("SYSEX message too long (>");
         CFI_DEBUG_PRINT(CFI_CLIENT_MAX_DATA_BYTES);
         CFI_DEBUG_PRINTLN(")!");
+        _sysexOverflows++;
         parsingSysex = false;
+        skippingSysex = true;
       } else {
         //normal data byte - add to buffer
         storedInputData[sysexBytesRead] = inputData;
         sysexBytesRead++;
       }
     }
-  } else if (waitForData > 0) {
+  } else if (waitForData > 0 && inputData <= 0x7F) {
     waitForData--;
     storedInputData[waitForData] = inputData;
     if ((waitForData == 0) && executeMultiByteCommand) { // got the whole message
@@ -265,6 +393,15 @@ void CFI_ClientFirmata::parse(byte inputData)
           }
           break;
         case CFI_REPORT_VERSION:
+          if (_probePending) {
+            // reply of the round trip probe
+            _roundTrips[_roundTripNext] = micros() - _probeMicros;
+            _roundTripNext = (_roundTripNext + 1) % CFI_LINK_RTT_SAMPLES;
+            if (_roundTripCount < CFI_LINK_RTT_SAMPLES) {
+              _roundTripCount++;
+            }
+            _probePending = false;
+          }
           CFI_DEBUG_PRINT("Firmata protocol version ");
           CFI_DEBUG_PRINT(storedInputData[1]);
           CFI_DEBUG_PRINT('.');
@@ -276,6 +413,13 @@ void CFI_ClientFirmata::parse(byte inputData)
       executeMultiByteCommand = 0;
     }
   } else if (inputData > 0x7F) {
+    if (waitForData > 0) {
+      // truncated message, resynchronize with this command
+      _parseErrors++;
+      waitForData = 0;
+      executeMultiByteCommand = 0;
+    }
+    _messagesReceived++;
     // remove channel info from command byte if less than 0xF0
     if (inputData < 0xF0) {
       command = inputData & 0xF0;
@@ -309,6 +453,9 @@ void CFI_ClientFirmata::parse(byte inputData)
       default:
         break;
     }
+  } else {
+    // data byte without a command
+    _parseErrors++;
   }
 }
 
@@ -342,6 +489,7 @@ boolean CFI_ClientFirmata::isResetting(void)
  */
 void CFI_ClientFirmata::sendAnalog(byte pin, int value)
 {
+  std::lock_guard<std::recursive_mutex> lock(_ioMutex);
   // pin can only be 0-15, so chop higher bits
   write(CFI_ANALOG_MESSAGE | (pin & 0xF));
   sendValueAsTwo7bitBytes(value);
@@ -357,6 +505,7 @@ void CFI_ClientFirmata::sendAnalog(byte pin, int value)
  */
 void CFI_ClientFirmata::sendDigitalPort(byte portNumber, int portData)
 {
+  std::lock_guard<std::recursive_mutex> lock(_ioMutex);
   write(CFI_DIGITAL_MESSAGE | (portNumber & 0xF));
   write((byte)portData % 128); // Tx bits 0-6
   write(portData >> 7);  // Tx bits 7-13
@@ -406,18 +555,25 @@ void CFI_ClientFirmata::sendString(const char *string)
  */
 void CFI_ClientFirmata::write(byte c)
 {
-  while (_stream->write(c) != 1) {
-    Serial.print('~');
-    _sleep(5);
-  }
+  write(&c, 1);
 }
 
 void CFI_ClientFirmata::write(const uint8_t *buf, size_t size)
 {
+  std::lock_guard<std::recursive_mutex> lock(_ioMutex);
+  countSent(buf, size);
   size_t sent = _stream->write(buf, size);
   size -= sent;
 
+  unsigned long start = millis();
   while (size > 0) {
+    if (millis() - start >= CFI_WRITE_STALL_TIMEOUT) {
+      // the board does not take the bytes, give up instead of hanging the sketch
+      _bytesDropped += size;
+      CFI_DEBUG_PRINTLN("write: stream stalled, bytes dropped");
+      break;
+    }
+    _writeStalls++;
     Serial.print('~');
     _sleep(5);
     buf += sent;
@@ -433,11 +589,13 @@ void CFI_ClientFirmata::write(const uint8_t *buf, size_t size)
 void CFI_ClientFirmata::attach(CFI_DigitalInputFeature & feature)
 {
   _digitalInput = &feature;
+  addFeature(feature);
 }
 
 void CFI_ClientFirmata::attach(CFI_AnalogInputFeature & feature)
 {
   _analogInput = &feature;
+  addFeature(feature);
 }
 
 /**
@@ -503,14 +661,169 @@ void CFI_ClientFirmata::setPinMode(byte pin, byte config)
   write(message, 3);
 }
 
+/**
+ * Set the interval at which the board samples and reports analog inputs
+ * (and I2C continuous reads).
+ * @param interval The sampling interval in milliseconds (14 bits).
+ */
+void CFI_ClientFirmata::setSamplingInterval(unsigned int interval)
+{
+  byte message[5];
+
+  if (interval > 0x3FFF) {
+    interval = 0x3FFF;
+  }
+  message[0] = CFI_START_SYSEX;
+  message[1] = CFI_SAMPLING_INTERVAL;
+  message[2] = interval & 0x7F;
+  message[3] = (interval >> 7) & 0x7F;
+  message[4] = CFI_END_SYSEX;
+  write(message, 5);
+
+  _samplingInterval = interval;
+}
+
+/**
+ * @return The sampling interval last sent to the board in milliseconds.
+ */
+unsigned int CFI_ClientFirmata::getSamplingInterval(void)
+{
+  return _samplingInterval;
+}
+
+/**
+ * Set the baud rate of the stream transport. It is used to budget the
+ * data the board reports, 0 means unknown.
+ * @param baudRate The baud rate of the serial link.
+ */
+void CFI_ClientFirmata::setLinkBaudRate(unsigned long baudRate)
+{
+  _linkBaudRate = baudRate;
+}
+
+unsigned long CFI_ClientFirmata::getLinkBaudRate(void)
+{
+  return _linkBaudRate;
+}
+
+/**
+ * @return The total number of bytes received from the board.
+ */
+unsigned long CFI_ClientFirmata::getBytesReceived(void)
+{
+  return _bytesReceived;
+}
+
+/**
+ * Send a REPORT_VERSION query every interval and measure the time until the
+ * board replies. The probe is sent from update(), so it never splits a message.
+ * @param interval The probe interval in milliseconds, 0 stops the probes.
+ */
+void CFI_ClientFirmata::setProbeInterval(unsigned long interval)
+{
+  _probeInterval = interval;
+}
+
+/**
+ * @param percentile 0 = minimum, 50 = median, 100 = maximum.
+ * @return The round trip time of the latest probes in microseconds, 0 if none was answered.
+ */
+unsigned long CFI_ClientFirmata::getRoundTripTime(byte percentile)
+{
+  if (_roundTripCount == 0) {
+    return 0;
+  }
+  unsigned long sorted[CFI_LINK_RTT_SAMPLES];
+  memcpy(sorted, _roundTrips, _roundTripCount * sizeof(unsigned long));
+  std::sort(sorted, sorted + _roundTripCount);
+  if (percentile > 100) {
+    percentile = 100;
+  }
+  return sorted[(_roundTripCount - 1) * percentile / 100];
+}
+
+void CFI_ClientFirmata::getStatistics(CFI_LinkStatistics& statistics)
+{
+  statistics.bytesSent = _bytesSent;
+  statistics.bytesReceived = _bytesReceived;
+  statistics.messagesSent = _messagesSent;
+  statistics.messagesReceived = _messagesReceived;
+  statistics.bytesSentPerSecond = _rates[0];
+  statistics.bytesReceivedPerSecond = _rates[1];
+  statistics.messagesSentPerSecond = _rates[2];
+  statistics.messagesReceivedPerSecond = _rates[3];
+  statistics.parseErrors = _parseErrors;
+  statistics.sysexOverflows = _sysexOverflows;
+  statistics.writeStalls = _writeStalls;
+  statistics.bytesDropped = _bytesDropped;
+  statistics.probesSent = _probesSent;
+  statistics.probesLost = _probesLost;
+  statistics.roundTripMin = getRoundTripTime(0);
+  statistics.roundTripMedian = getRoundTripTime(50);
+  statistics.roundTrip90 = getRoundTripTime(90);
+  statistics.roundTrip99 = getRoundTripTime(99);
+  statistics.roundTripMax = getRoundTripTime(100);
+}
+
+void CFI_ClientFirmata::printStatistics(Print& out)
+{
+  CFI_LinkStatistics statistics;
+  getStatistics(statistics);
+
+  out.print("Firmata link: sent ");
+  out.print(statistics.bytesSent);
+  out.print(" bytes / ");
+  out.print(statistics.messagesSent);
+  out.print(" messages, received ");
+  out.print(statistics.bytesReceived);
+  out.print(" bytes / ");
+  out.print(statistics.messagesReceived);
+  out.println(" messages");
+  out.print("  last second: sent ");
+  out.print(statistics.bytesSentPerSecond);
+  out.print(" B/s ");
+  out.print(statistics.messagesSentPerSecond);
+  out.print(" msg/s, received ");
+  out.print(statistics.bytesReceivedPerSecond);
+  out.print(" B/s ");
+  out.print(statistics.messagesReceivedPerSecond);
+  out.println(" msg/s");
+  out.print("  parse errors ");
+  out.print(statistics.parseErrors);
+  out.print(", sysex overflows ");
+  out.print(statistics.sysexOverflows);
+  out.print(", write stalls ");
+  out.print(statistics.writeStalls);
+  out.print(", bytes dropped ");
+  out.println(statistics.bytesDropped);
+  if (statistics.probesSent > 0) {
+    out.print("  round trip us: min ");
+    out.print(statistics.roundTripMin);
+    out.print(" median ");
+    out.print(statistics.roundTripMedian);
+    out.print(" 90% ");
+    out.print(statistics.roundTrip90);
+    out.print(" 99% ");
+    out.print(statistics.roundTrip99);
+    out.print(" max ");
+    out.print(statistics.roundTripMax);
+    out.print(" (");
+    out.print(statistics.probesSent);
+    out.print(" probes, ");
+    out.print(statistics.probesLost);
+    out.println(" lost)");
+  }
+}
+
 //******************************************************************************
 //* Private Methods
 //******************************************************************************
 
 boolean CFI_ClientFirmata::featureHandleSysex(byte command, int argc, byte * argv)
 {
-  for (byte i = 0; i < numFeatures; i++) {
-    if (features[i]->handleSysex(command, argc, argv)) {
+  uint32_t handlers = _sysexHandlers[command & 0x7F];
+  for (byte i = 0; handlers != 0; i++, handlers >>= 1) {
+    if ((handlers & 1) && features[i]->handleSysex(command, argc, argv)) {
       return true;
     }
   }
@@ -521,7 +834,46 @@ boolean CFI_ClientFirmata::featureHandleSysex(byte command, int argc, byte * arg
 
 void CFI_ClientFirmata::updateFeatures()
 {
-  for (byte i = 0; i < numFeatures; i++) {
-    features[i]->updateFeature();
+  for (byte i = 0; i < _numUpdateFeatures; i++) {
+    _updateFeatures[i]->updateFeature();
+  }
+}
+
+void CFI_ClientFirmata::updateStatistics()
+{
+  unsigned long now = millis();
+  if (now - _ratesMillis >= 1000) {
+    unsigned long counters[4] = { _bytesSent, _bytesReceived, _messagesSent, _messagesReceived };
+    for (byte i = 0; i < 4; i++) {
+      _rates[i] = (counters[i] - _lastRates[i]) * 1000 / (now - _ratesMillis);
+      _lastRates[i] = counters[i];
+    }
+    _ratesMillis = now;
+  }
+
+  if (_probeInterval == 0) {
+    return;
+  }
+  if (_probePending && now - _probeMillis >= CFI_LINK_PROBE_TIMEOUT) {
+    _probePending = false;
+    _probesLost++;
+  }
+  if (!_probePending && now - _probeMillis >= _probeInterval) {
+    _probeMillis = now;
+    _probeMicros = micros();
+    _probePending = true;
+    _probesSent++;
+    write(CFI_REPORT_VERSION);
+  }
+}
+
+void CFI_ClientFirmata::countSent(const uint8_t* buf, size_t size)
+{
+  _bytesSent += size;
+  for (size_t i = 0; i < size; i++) {
+    // every message starts with a command byte
+    if ((buf[i] & 0x80) && buf[i] != CFI_END_SYSEX) {
+      _messagesSent++;
+    }
   }
 }
@@ -13,13 +13,41 @@
 #ifndef CFI_ClientFirmata_h
 #define CFI_ClientFirmata_h
 
+#include <mutex>
 #include "CFI_ClientFirmataDebug.h"
 
 #include "CFI_FirmataDefines.h"
 
 #define CFI_CLIENT_MAX_DATA_BYTES 512
 
-#define CFI_MAX_FEATURES CFI_TOTAL_PIN_MODES + 1
+#define CFI_MAX_FEATURES CFI_TOTAL_PIN_MODES + 1 // at most 32, see _sysexHandlers
+
+// A read after an idle report was switched off turns it on again and waits
+// one round trip, up to CFI_REPORT_RESUME_TIMEOUT, for the board's first value.
+// Sketches reading less often than every 2 s should raise the timeout or set 0.
+#if !defined(CFI_REPORT_IDLE_TIMEOUT)
+#define CFI_REPORT_IDLE_TIMEOUT 2000 // ms without reads until a port or channel report is switched off, 0 = never
+#endif
+
+#if !defined(CFI_REPORT_RESUME_TIMEOUT)
+#define CFI_REPORT_RESUME_TIMEOUT 100 // ms to wait for the first value after a report was switched on again
+#endif
+
+#if !defined(CFI_DEFAULT_SAMPLING_INTERVAL)
+#define CFI_DEFAULT_SAMPLING_INTERVAL 19 // ms, sampling interval of StandardFirmata after reset
+#endif
+
+#if !defined(CFI_WRITE_STALL_TIMEOUT)
+#define CFI_WRITE_STALL_TIMEOUT 1000 // ms a write waits for the stream to take its bytes before they are dropped
+#endif
+
+#if !defined(CFI_LINK_PROBE_TIMEOUT)
+#define CFI_LINK_PROBE_TIMEOUT 1000 // ms until an unanswered round trip probe counts as lost
+#endif
+
+#if !defined(CFI_LINK_RTT_SAMPLES)
+#define CFI_LINK_RTT_SAMPLES 64 // latest round trip times kept for the percentiles
+#endif
 
 #include "CFI_ClientFirmataFeature.h"
 #include "CFI_DigitalInputFeature.h"
@@ -27,6 +55,34 @@
 #include "CFI_AnalogInputFeature.h"
 #include "CFI_AnalogOutputFeature.h"
 #include "CFI_SPIFeature.h"
+#include "CFI_ShiftFeature.h"
+#include "CFI_PingFeature.h"
+
+class UDP;
+
+// Counters of the stream transport, rates of the last full second,
+// round trip times in microseconds
+typedef struct {
+    unsigned long bytesSent;
+    unsigned long bytesReceived;
+    unsigned long messagesSent;
+    unsigned long messagesReceived;
+    unsigned long bytesSentPerSecond;
+    unsigned long bytesReceivedPerSecond;
+    unsigned long messagesSentPerSecond;
+    unsigned long messagesReceivedPerSecond;
+    unsigned long parseErrors; // unexpected bytes, truncated messages
+    unsigned long sysexOverflows; // sysex messages longer than CFI_CLIENT_MAX_DATA_BYTES
+    unsigned long writeStalls; // writes the stream did not accept at once
+    unsigned long bytesDropped; // bytes given up after CFI_WRITE_STALL_TIMEOUT
+    unsigned long probesSent;
+    unsigned long probesLost;
+    unsigned long roundTripMin;
+    unsigned long roundTripMedian;
+    unsigned long roundTrip90;
+    unsigned long roundTrip99;
+    unsigned long roundTripMax;
+} CFI_LinkStatistics;
 
 extern "C" {
     // callback function types
@@ -40,12 +96,14 @@ public:
     /* constructors */
     CFI_ClientFirmata();
     void begin(Stream& s);
+    void beginReports(UDP& udp);
     /* update and feature functions */
     void update();
     void addFeature(CFI_ClientFirmataFeature& capability);
     byte nextInstanceNumber(byte classId);
     /* serial receive handling */
     int available(void);
+    void waitForInput(unsigned long timeout);
     void processInput(void);
     void parse(unsigned char value);
     boolean isParsingMessage(void);
@@ -73,12 +131,29 @@ public:
     /* access pin state */
     int getPinState(byte pin);
     void setPinState(byte pin, int state);
+    /* board sampling interval */
+    void setSamplingInterval(unsigned int interval);
+    unsigned int getSamplingInterval(void);
+    /* link properties */
+    void setLinkBaudRate(unsigned long baudRate);
+    unsigned long getLinkBaudRate(void);
+    unsigned long getBytesReceived(void);
+    /* link statistics */
+    void setProbeInterval(unsigned long interval);
+    unsigned long getRoundTripTime(byte percentile);
+    void getStatistics(CFI_LinkStatistics& statistics);
+    void printStatistics(Print& out);
 
     /* utility methods */
     void sendValueAsTwo7bitBytes(int value);
     void startSysex(void);
     void endSysex(void);
 
+    /* Guards the stream and the parser against an interrupt thread, held by
+       update(), the send functions and from startSysex() to endSysex() */
+    void lock() { _ioMutex.lock(); }
+    void unlock() { _ioMutex.unlock(); }
+
 private:
     typedef struct {
         byte classId;
@@ -86,6 +161,7 @@ private:
     } instanceTable_t;
 
     Stream* _stream;
+    UDP* _reports;
 
     static const byte _instanceTableSize = 4;
     instanceTable_t _instanceTable[_instanceTableSize];
@@ -97,13 +173,43 @@ private:
     byte storedInputData[CFI_CLIENT_MAX_DATA_BYTES];//MAX_DATA_BYTES]; // multi-byte data
     /* sysex */
     boolean parsingSysex;
+    boolean skippingSysex; // drop the data bytes up to END_SYSEX after an overflow
     int sysexBytesRead;
 
     boolean resetting;
 
+    unsigned int _samplingInterval;
+    unsigned long _linkBaudRate;
+    unsigned long _bytesReceived;
+
+    /* link statistics */
+    unsigned long _bytesSent;
+    unsigned long _messagesSent;
+    unsigned long _messagesReceived;
+    unsigned long _parseErrors;
+    unsigned long _sysexOverflows;
+    unsigned long _writeStalls;
+    unsigned long _bytesDropped;
+    std::recursive_mutex _ioMutex;
+    unsigned long _lastRates[4]; // counters at the start of the current second
+    unsigned long _rates[4]; // bytes sent, received, messages sent, received in the last second
+    unsigned long _ratesMillis;
+    unsigned long _probeInterval; // ms, 0 = no probes
+    unsigned long _probeMicros; // when the pending probe was sent
+    unsigned long _probeMillis; // when the last probe was sent
+    bool _probePending;
+    unsigned long _probesSent;
+    unsigned long _probesLost;
+    unsigned long _roundTrips[CFI_LINK_RTT_SAMPLES];
+    byte _roundTripCount;
+    byte _roundTripNext;
+
     /* features handling */
     CFI_ClientFirmataFeature* features[CFI_MAX_FEATURES];
     byte numFeatures;
+    uint32_t _sysexHandlers[128]; // bit i set = features[i] handles this sysex command
+    CFI_ClientFirmataFeature* _updateFeatures[CFI_MAX_FEATURES];
+    byte _numUpdateFeatures;
     CFI_DigitalInputFeature* _digitalInput;
     CFI_AnalogInputFeature* _analogInput;
 
@@ -113,10 +219,13 @@ private:
 
     /* private methods ------------------------------ */
     void processSysexMessage(void);
+    void processReports(void);
     void two7bitArrayToStr(unsigned char* buffer, byte length);
 
     boolean featureHandleSysex(byte command, int argc, byte* argv);
     void updateFeatures();
+    void updateStatistics();
+    void countSent(const uint8_t* buf, size_t size);
 };
 
 #endif /* CFI_ClientFirmata_h */
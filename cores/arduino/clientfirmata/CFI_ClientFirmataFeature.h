@@ -19,6 +19,10 @@ class CFI_ClientFirmataFeature
     virtual void setPinMode(byte pin, int mode) = 0;
     virtual boolean handleSysex(byte command, int argc, byte* argv) = 0;
     virtual void updateFeature() = 0;
+    // Commands passed to handleSysex(), asked once when the feature is added
+    virtual boolean handlesSysex(byte command) { return true; }
+    // False if updateFeature() has nothing to do, it is then never called
+    virtual boolean hasUpdate() { return true; }
 };
 
 #endif
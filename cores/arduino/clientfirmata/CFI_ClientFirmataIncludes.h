@@ -19,9 +19,18 @@
 #include "CFI_ClientEncoder7Bit.cpp"
 #include "CFI_DigitalInputFeature.cpp"
 #include "CFI_DigitalOutputFeature.cpp"
+#include "CFI_ShiftFeature.cpp"
+#include "CFI_PingFeature.cpp"
+#include "CFI_AnalogCapture.cpp"
 #include "CFI_AnalogInputFeature.cpp"
 #include "CFI_AnalogOutputFeature.cpp"
 #include "CFI_SPIFeature.cpp"
 #include "CFI_I2CFeature.cpp"
+#include "CFI_EncoderFeature.cpp"
+#include "CFI_OneWireFeature.cpp"
+#include "CFI_StepperFeature.cpp"
+#include "CFI_SchedulerFeature.cpp"
+#include "CFI_BoardSimulator.cpp"
+#include "CFI_StreamRecorder.cpp"
 
 #endif
\ No newline at end of file
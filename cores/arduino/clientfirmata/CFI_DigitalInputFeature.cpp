@@ -15,96 +15,201 @@
 static void nothing(void) {
 }
 
-#if defined(EXTERNAL_NUM_INTERRUPTS)
-static volatile int intMode[EXTERNAL_NUM_INTERRUPTS] = { 0 };
-static volatile bool intState[EXTERNAL_NUM_INTERRUPTS] = { false };
-static volatile bool intPending[EXTERNAL_NUM_INTERRUPTS] = { false };
-static volatile voidFuncPtr intFunc[EXTERNAL_NUM_INTERRUPTS] = {
-#if EXTERNAL_NUM_INTERRUPTS > 8
-    #warning There are more than 8 external interrupts.Some callbacks may not be initialized.
-    nothing,
-#endif
-#if EXTERNAL_NUM_INTERRUPTS > 7
-    nothing,
-#endif
-#if EXTERNAL_NUM_INTERRUPTS > 6
-    nothing,
-#endif
-#if EXTERNAL_NUM_INTERRUPTS > 5
-    nothing,
-#endif
-#if EXTERNAL_NUM_INTERRUPTS > 4
-    nothing,
-#endif
-#if EXTERNAL_NUM_INTERRUPTS > 3
-    nothing,
-#endif
-#if EXTERNAL_NUM_INTERRUPTS > 2
-    nothing,
-#endif
-#if EXTERNAL_NUM_INTERRUPTS > 1
-    nothing,
-#endif
-#if EXTERNAL_NUM_INTERRUPTS > 0
-    nothing,
-#endif
-};
-#else
+#if !defined(EXTERNAL_NUM_INTERRUPTS)
 #pragma message ("WARNING: No pin interrupt feature supported")
 #endif // EXTERNAL_NUM_INTERRUPTS
 
-CFI_DigitalInputFeature::CFI_DigitalInputFeature(CFI_ClientFirmata &firmata) : _firmata(&firmata)
+CFI_DigitalInputFeature::CFI_DigitalInputFeature(CFI_ClientFirmata &firmata) : _firmata(&firmata),
+  _reportIdleTimeout(CFI_REPORT_IDLE_TIMEOUT)
 {
   for (size_t i = 0; i < 16; i++) {
     _digitalPorts[i] = 0;
+    _inputPins[i] = 0;
+    _subscribers[i] = 0;
     _reportPorts[i] = false;
+    _pendingPorts[i] = false;
+    _lastRead[i] = 0;
+    _risingMask[i] = 0;
+    _fallingMask[i] = 0;
+    _rawPorts[i] = 0;
+    _debounceMask[i] = 0;
+  }
+  for (size_t i = 0; i < 128; i++) {
+    _debounce[i].mode = CFI_DEBOUNCE_NONE;
+    _debounce[i].time = 0;
+    _debounce[i].count = 0;
+    _debounce[i].since = 0;
+  }
+#if defined(EXTERNAL_NUM_INTERRUPTS)
+  for (size_t i = 0; i < EXTERNAL_NUM_INTERRUPTS; i++) {
+    intMode[i] = 0;
+    intPin[i] = -1;
+    intMissed[i] = 0;
+    intFunc[i] = nothing;
   }
+#endif // EXTERNAL_NUM_INTERRUPTS
   _firmata->attach(*this);
 }
 
 void CFI_DigitalInputFeature::setDigitalPort(byte port, int value)
 {
   if (port < 16) {
-    _digitalPorts[port] = value;
+    if (_pendingPorts[port]) {
+      // first value after the report was switched on, nothing to filter
+      _pendingPorts[port] = false;
+      _rawPorts[port] = value;
+      applyPort(port, value);
+      return;
+    }
+    // settle the filters with the previous level before it changes
+    debouncePort(port);
+    _rawPorts[port] = value;
+    debouncePort(port);
+  }
+}
 
-#if defined(EXTERNAL_NUM_INTERRUPTS)
-    if (port == 0) {
-      for (size_t i = 0; i < 8; i++) {
-        int8_t intNum = digitalPinToInterrupt(i);
-        if (intNum != NOT_AN_INTERRUPT) {
-          if (intFunc[intNum] != nothing) {
-            bool pinValue = (value & (1 << (i & 0x07))) != 0;
-
-            bool intTrigger = false;
-            switch (intMode[intNum])
-            {
-            case CHANGE:
-              intTrigger = pinValue != intState[intNum];
-              break;
-            case FALLING:
-              intTrigger = !pinValue && intState[intNum];
-              break;
-            case RISING:
-              intTrigger = pinValue && !intState[intNum];
-              break;
-            default:
-              break;
-            }
+// The pins of the debounce mask follow the filtered level, all others the raw one
+void CFI_DigitalInputFeature::debouncePort(byte port)
+{
+  byte mask = _debounceMask[port];
+  int raw = _rawPorts[port];
+  int value = (raw & ~mask) | (_digitalPorts[port] & mask);
+  unsigned long now = millis();
 
-            intState[intNum] = pinValue;
-            if (intTrigger) {
-              if (interruptsEnabled) {
-                intFunc[intNum]();
-              } else {
-                intPending[intNum] = true;
-              }
-            }
-          }
-        }
+  for (byte i = 0; mask != 0; i++, mask >>= 1) {
+    if ((mask & 1) == 0) {
+      continue;
+    }
+    debounce_t& filter = _debounce[(port << 3) | i];
+    int bit = 1 << i;
+    bool level = (raw & bit) != 0;
+    bool stable = (value & bit) != 0;
+
+    if (filter.mode == CFI_DEBOUNCE_TIME) {
+      if (level == stable) {
+        filter.since = now;
+      }
+      else if (now - filter.since >= filter.time) {
+        value ^= bit;
+        filter.since = now;
       }
     }
+    else {
+      // one integration step per elapsed millisecond
+      unsigned long steps = now - filter.since;
+      filter.since = now;
+      if (level) {
+        filter.count = steps >= (unsigned long)(filter.time - filter.count) ? filter.time : filter.count + steps;
+      }
+      else {
+        filter.count = steps >= filter.count ? 0 : filter.count - steps;
+      }
+      if (filter.count == filter.time) {
+        value |= bit;
+      }
+      else if (filter.count == 0) {
+        value &= ~bit;
+      }
+    }
+  }
+  applyPort(port, value);
+}
+
+void CFI_DigitalInputFeature::applyPort(byte port, int value)
+{
+  int changed = _digitalPorts[port] ^ value;
+  _digitalPorts[port] = value;
+
+  if (_pulsePin >= 0 && (_pulsePin >> 3) == port && (changed & (1 << (_pulsePin & 0x07)))) {
+    trackPulse((value >> (_pulsePin & 0x07)) & 0x01);
+  }
+
+#if defined(EXTERNAL_NUM_INTERRUPTS)
+  // rising edges changed to high, falling edges changed to low
+  byte edges = (changed & value & _risingMask[port]) |
+               (changed & ~value & _fallingMask[port]);
+  if (edges != 0) {
+    queueEdges(port, edges, value);
+    if (interruptsEnabled) {
+      dispatchEdges();
+    }
+  }
 #endif // EXTERNAL_NUM_INTERRUPTS
+}
+
+void CFI_DigitalInputFeature::trackPulse(byte level)
+{
+  switch (_pulsePhase) {
+  case CFI_PULSE_WAIT_IDLE:
+    if (level != _pulseState) {
+      _pulsePhase = CFI_PULSE_WAIT_START;
+    }
+    break;
+  case CFI_PULSE_WAIT_START:
+    if (level == _pulseState) {
+      _pulseStart = micros();
+      _pulsePhase = CFI_PULSE_WAIT_END;
+    }
+    break;
+  case CFI_PULSE_WAIT_END:
+    if (level != _pulseState) {
+      _pulseEnd = micros();
+      _pulsePhase = CFI_PULSE_DONE;
+    }
+    break;
+  }
+}
+
+// Measures the pulse from the decode timestamps of its two port messages
+// and sleeps while no input arrives. Returns the length in microseconds
+// or 0 if no complete pulse was seen within the timeout.
+unsigned long CFI_DigitalInputFeature::pulseIn(byte pin, byte state, unsigned long timeout)
+{
+  beginPulse(pin, state);
+
+  unsigned long startMicros = micros();
+  while (!pulseDone()) {
+    unsigned long elapsed = micros() - startMicros;
+    if (elapsed >= timeout) {
+      break;
+    }
+    _firmata->update();
+    if (!pulseDone()) {
+      _firmata->waitForInput(timeout - elapsed);
+    }
+  }
+  return endPulse();
+}
+
+// The steps of pulseIn() for a caller whose own thread runs update(),
+// e.g. the I/O thread of an added board
+void CFI_DigitalInputFeature::beginPulse(byte pin, byte state)
+{
+  byte port = (pin >> 3) & 0x0F;
+  subscribePort(port);
+  waitForPortValue(port);
+
+  _pulseState = state ? 1 : 0;
+  _pulsePhase = CFI_PULSE_WAIT_IDLE;
+  _pulsePin = pin;
+  trackPulse((_digitalPorts[port] >> (pin & 0x07)) & 0x01);
+}
+
+bool CFI_DigitalInputFeature::pulseDone()
+{
+  return _pulsePhase == CFI_PULSE_DONE;
+}
+
+unsigned long CFI_DigitalInputFeature::endPulse()
+{
+  if (_pulsePin < 0) {
+    return 0;
   }
+  byte port = (_pulsePin >> 3) & 0x0F;
+  _pulsePin = -1;
+  unsubscribePort(port);
+
+  return _pulsePhase == CFI_PULSE_DONE ? _pulseEnd - _pulseStart : 0;
 }
 
 void CFI_DigitalInputFeature::setPinMode(byte pin, int mode)
@@ -112,26 +217,123 @@ void CFI_DigitalInputFeature::setPinMode(byte pin, int mode)
   _firmata->setPinMode(pin, mode);
 
   byte port = (pin >> 3) & 0x0F;
+  _inputPins[port] |= (1 << (pin & 0x07));
+  _lastRead[port] = millis();
   if (!_reportPorts[port]) {
-    reportDigitalPort(port);
+    reportDigitalPort(port, true);
+  }
+}
+
+// The pin is no longer an input (e.g. switched to OUTPUT): drop its
+// reference and silence the port if nobody else consumes it.
+void CFI_DigitalInputFeature::releasePin(byte pin)
+{
+  byte port = (pin >> 3) & 0x0F;
+  _inputPins[port] &= ~(1 << (pin & 0x07));
+  if (_reportPorts[port] && !isPortUsed(port)) {
+    reportDigitalPort(port, false);
+  }
+}
+
+// Subscribers keep the port reported regardless of the idle timeout,
+// e.g. while an interrupt is attached to one of its pins.
+void CFI_DigitalInputFeature::subscribePort(byte port)
+{
+  if (port < 16) {
+    if (_subscribers[port] < 255) {
+      _subscribers[port]++;
+    }
+    if (!_reportPorts[port]) {
+      reportDigitalPort(port, true);
+    }
+  }
+}
+
+void CFI_DigitalInputFeature::unsubscribePort(byte port)
+{
+  if (port < 16 && _subscribers[port] > 0) {
+    _subscribers[port]--;
+    _lastRead[port] = millis();
+    if (_reportPorts[port] && !isPortUsed(port)) {
+      reportDigitalPort(port, false);
+    }
+  }
+}
+
+void CFI_DigitalInputFeature::setReportIdleTimeout(unsigned long timeout)
+{
+  _reportIdleTimeout = timeout;
+}
+
+// Filters the pin in front of getPinValue() and the interrupt edge
+// detection. The time is the debounce time in milliseconds or, for
+// the integrator, the count of milliseconds the level must dominate.
+void CFI_DigitalInputFeature::setDebounce(byte pin, byte mode, uint16_t time)
+{
+  if (pin >= 128) {
+    return;
   }
+  byte port = (pin >> 3) & 0x0F;
+  byte bit = 1 << (pin & 0x07);
+  debounce_t& filter = _debounce[pin];
+
+  if (mode == CFI_DEBOUNCE_NONE || time == 0) {
+    filter.mode = CFI_DEBOUNCE_NONE;
+    _debounceMask[port] &= ~bit;
+    debouncePort(port);
+    return;
+  }
+  filter.mode = mode;
+  filter.time = time;
+  filter.count = (_digitalPorts[port] & bit) != 0 ? time : 0;
+  filter.since = millis();
+  _debounceMask[port] |= bit;
 }
 
-void CFI_DigitalInputFeature::reportDigitalPort(byte port)
+bool CFI_DigitalInputFeature::isPortUsed(byte port)
+{
+  return _inputPins[port] != 0 || _subscribers[port] > 0;
+}
+
+void CFI_DigitalInputFeature::reportDigitalPort(byte port, bool enable)
 {
   byte message[2];
 
   message[0] = (byte)(CFI_REPORT_DIGITAL | port);
-  message[1] = 1;
+  message[1] = enable ? 1 : 0;
   _firmata->write(message, 2);
 
-  _reportPorts[port] = true;
+  _reportPorts[port] = enable;
+  _pendingPorts[port] = enable;
+}
+
+// The board answers REPORT_DIGITAL with the current port value, so a
+// read after an idle period does not return the stale value.
+void CFI_DigitalInputFeature::waitForPortValue(byte port)
+{
+  unsigned long startMicros = micros();
+  while (_pendingPorts[port]) {
+    unsigned long elapsed = micros() - startMicros;
+    if (elapsed >= CFI_REPORT_RESUME_TIMEOUT * 1000UL) {
+      break;
+    }
+    _firmata->update();
+    if (_pendingPorts[port]) {
+      _firmata->waitForInput(CFI_REPORT_RESUME_TIMEOUT * 1000UL - elapsed);
+    }
+  }
 }
 
 bool CFI_DigitalInputFeature::getPinValue(byte pin)
 {
   int port = (pin >> 3) & 0x0F;
 
+  _lastRead[port] = millis();
+  if (!_reportPorts[port] && isPortUsed(port)) {
+    reportDigitalPort(port, true);
+    waitForPortValue(port);
+  }
+
   byte value = _digitalPorts[port] & (1 << (pin & 0x07));
   return value != 0;
 }
@@ -143,14 +345,44 @@ boolean CFI_DigitalInputFeature::handleSysex(byte command, int argc, byte* argv)
 
 void CFI_DigitalInputFeature::updateFeature()
 {
+  // a level is accepted after some time even without new port messages
+  for (byte port = 0; port < 16; port++) {
+    if (_debounceMask[port] != 0 && !_pendingPorts[port]) {
+      debouncePort(port);
+    }
+  }
+
+  if (_reportIdleTimeout == 0) {
+    return;
+  }
+  unsigned long now = millis();
+  for (byte port = 0; port < 16; port++) {
+    if (_reportPorts[port] && _subscribers[port] == 0 &&
+        now - _lastRead[port] >= _reportIdleTimeout) {
+      reportDigitalPort(port, false);
+    }
+  }
+}
+
+boolean CFI_DigitalInputFeature::handlesSysex(byte command)
+{
+  return false;
 }
 
 void CFI_DigitalInputFeature::attachInterrupt(uint8_t interruptNum, void(*userFunc)(void), int mode)
 {
 #if defined(EXTERNAL_NUM_INTERRUPTS)
-    if (interruptNum < EXTERNAL_NUM_INTERRUPTS) {
+    if (interruptNum < EXTERNAL_NUM_INTERRUPTS && userFunc != NULL) {
+        if (intFunc[interruptNum] == nothing) {
+            intPin[interruptNum] = interruptToDigitalPin(interruptNum);
+            if (intPin[interruptNum] >= 0) {
+                // an attached interrupt keeps the port of its pin reported
+                subscribePort(intPin[interruptNum] >> 3);
+            }
+        }
         intFunc[interruptNum] = userFunc;
         intMode[interruptNum] = mode;
+        updateInterruptMasks();
     }
 #endif // EXTERNAL_NUM_INTERRUPTS
 }
@@ -158,31 +390,256 @@ void CFI_DigitalInputFeature::attachInterrupt(uint8_t interruptNum, void(*userFu
 void CFI_DigitalInputFeature::detachInterrupt(uint8_t interruptNum)
 {
 #if defined(EXTERNAL_NUM_INTERRUPTS)
-    if (interruptNum < EXTERNAL_NUM_INTERRUPTS) {
+    if (interruptNum < EXTERNAL_NUM_INTERRUPTS && intFunc[interruptNum] != nothing) {
         intFunc[interruptNum] = nothing;
+        updateInterruptMasks();
+        if (intPin[interruptNum] >= 0) {
+            unsubscribePort(intPin[interruptNum] >> 3);
+        }
     }
 #endif // EXTERNAL_NUM_INTERRUPTS
 }
 
-void CFI_DigitalInputFeature::interrupts()
+uint32_t CFI_DigitalInputFeature::missedInterrupts(uint8_t interruptNum)
 {
-  interruptsEnabled = true;
+#if defined(EXTERNAL_NUM_INTERRUPTS)
+    if (interruptNum < EXTERNAL_NUM_INTERRUPTS) {
+        return intMissed[interruptNum];
+    }
+#endif // EXTERNAL_NUM_INTERRUPTS
+    return 0;
+}
+
+// Timestamp of the edge whose handler is currently executed
+unsigned long CFI_DigitalInputFeature::interruptMicros()
+{
+    return _edgeMicros;
+}
 
+int CFI_DigitalInputFeature::interruptToDigitalPin(uint8_t interruptNum)
+{
+#if defined(EXTERNAL_NUM_INTERRUPTS)
+  for (int pin = 0; pin < 16 * 8; pin++) {
+    if (digitalPinToInterrupt(pin) == interruptNum) {
+      return pin;
+    }
+  }
+#endif // EXTERNAL_NUM_INTERRUPTS
+  return -1;
+}
+
+// Collect the pins with attached interrupts into per port edge masks
+void CFI_DigitalInputFeature::updateInterruptMasks()
+{
+  for (size_t port = 0; port < 16; port++) {
+    _risingMask[port] = 0;
+    _fallingMask[port] = 0;
+  }
+#if defined(EXTERNAL_NUM_INTERRUPTS)
+  for (size_t i = 0; i < EXTERNAL_NUM_INTERRUPTS; i++) {
+    int pin = intPin[i];
+    if (intFunc[i] == nothing || pin < 0) {
+      continue;
+    }
+    byte bit = 1 << (pin & 0x07);
+    if (intMode[i] == CHANGE || intMode[i] == RISING) {
+      _risingMask[pin >> 3] |= bit;
+    }
+    if (intMode[i] == CHANGE || intMode[i] == FALLING) {
+      _fallingMask[pin >> 3] |= bit;
+    }
+  }
+#endif // EXTERNAL_NUM_INTERRUPTS
+}
+
+void CFI_DigitalInputFeature::queueEdges(byte port, byte edges, int value)
+{
+  unsigned long timestamp = micros();
+  std::lock_guard<std::mutex> lock(_edgeMutex);
+  for (byte i = 0; edges != 0; i++, edges >>= 1) {
+    if ((edges & 1) == 0) {
+      continue;
+    }
+    byte pin = (port << 3) | i;
+    if (_edgeHead - _edgeTail >= CFI_EDGE_QUEUE_SIZE) {
 #if defined(EXTERNAL_NUM_INTERRUPTS)
-  for (size_t i = 0; i < 8; i++) {
-    int8_t intNum = digitalPinToInterrupt(i);
-    if (intNum != NOT_AN_INTERRUPT) {
-      if (intFunc[intNum] != nothing && intPending[intNum]) {
-        intPending[intNum] = false;
-        intFunc[intNum]();
+      int8_t intNum = digitalPinToInterrupt(pin);
+      if (intNum != NOT_AN_INTERRUPT) {
+        intMissed[intNum]++;
       }
+#endif // EXTERNAL_NUM_INTERRUPTS
+      continue;
     }
+    edge_t& edge = _edgeQueue[_edgeHead % CFI_EDGE_QUEUE_SIZE];
+    edge.timestamp = timestamp;
+    edge.pin = pin;
+    edge.level = (value >> i) & 0x01;
+    _edgeHead++;
+  }
+  _edgeSignal.notify_one();
+}
+
+bool CFI_DigitalInputFeature::popEdge(edge_t& edge)
+{
+  std::lock_guard<std::mutex> lock(_edgeMutex);
+  if (_edgeTail == _edgeHead) {
+    return false;
+  }
+  edge = _edgeQueue[_edgeTail % CFI_EDGE_QUEUE_SIZE];
+  _edgeTail++;
+  return true;
+}
+
+void CFI_DigitalInputFeature::callHandler(const edge_t& edge)
+{
+  unsigned long latency = micros() - edge.timestamp;
+  byte bucket = 0;
+  while (bucket < CFI_LATENCY_BUCKETS - 1 && (latency >> bucket) != 0) {
+    bucket++;
+  }
+  _latency[bucket].fetch_add(1, std::memory_order_relaxed);
+  _edgeMicros = edge.timestamp;
+
+#if defined(EXTERNAL_NUM_INTERRUPTS)
+  int8_t intNum = digitalPinToInterrupt(edge.pin);
+  if (intNum != NOT_AN_INTERRUPT && intFunc[intNum] != nothing) {
+    intFunc[intNum]();
   }
 #endif // EXTERNAL_NUM_INTERRUPTS
 }
 
+// Call the handlers of the queued edges in the order they were received
+void CFI_DigitalInputFeature::dispatchEdges()
+{
+  if (_threadRunning) {
+    // the interrupt thread dispatches
+    return;
+  }
+  if (_dispatching) {
+    return;
+  }
+  _dispatching = true;
+  edge_t edge;
+  while (interruptsEnabled && popEdge(edge)) {
+    callHandler(edge);
+  }
+  _dispatching = false;
+}
+
+// Optional mode: the handlers are called by a dedicated high priority
+// thread as soon as an edge is decoded. noInterrupts() then enters a
+// critical section which blocks the thread until interrupts().
+void CFI_DigitalInputFeature::beginInterruptThread()
+{
+  if (_threadRunning) {
+    return;
+  }
+  _threadRunning = true;
+  _interruptThread = std::thread(&CFI_DigitalInputFeature::interruptThread, this);
+#if defined(_WIN32)
+  SetThreadPriority(_interruptThread.native_handle(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+  sched_param param;
+  param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+  // needs privileges, keep the default priority otherwise
+  pthread_setschedparam(_interruptThread.native_handle(), SCHED_FIFO, &param);
+#endif
+}
+
+void CFI_DigitalInputFeature::endInterruptThread()
+{
+  if (!_threadRunning) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_edgeMutex);
+    _threadRunning = false;
+  }
+  _edgeSignal.notify_one();
+  leaveCriticalSection();
+  _interruptThread.join();
+}
+
+void CFI_DigitalInputFeature::interruptThread()
+{
+  while (true) {
+    edge_t edge;
+    {
+      std::unique_lock<std::mutex> lock(_edgeMutex);
+      _edgeSignal.wait(lock, [this] { return !_threadRunning || _edgeTail != _edgeHead; });
+      if (!_threadRunning) {
+        return;
+      }
+      edge = _edgeQueue[_edgeTail % CFI_EDGE_QUEUE_SIZE];
+      _edgeTail++;
+    }
+    // the handler owns the link like a real interrupt, the main thread
+    // continues after it with its next update() or message; the link is
+    // locked first, as in noInterrupts(), where comparator handlers may
+    // call it from inside update()
+    std::lock_guard<CFI_ClientFirmata> io(*_firmata);
+    std::lock_guard<std::recursive_mutex> cs(_criticalSection);
+    callHandler(edge);
+  }
+}
+
+uint32_t CFI_DigitalInputFeature::interruptLatency(byte bucket)
+{
+  return bucket < CFI_LATENCY_BUCKETS ? _latency[bucket].load() : 0;
+}
+
+// Upper bound in us of the given percentile of the interrupt latencies
+unsigned long CFI_DigitalInputFeature::interruptLatencyPercentile(byte percent)
+{
+  uint32_t total = 0;
+  for (byte i = 0; i < CFI_LATENCY_BUCKETS; i++) {
+    total += _latency[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  uint32_t limit = (uint32_t)(((uint64_t)total * percent + 99) / 100);
+  uint32_t count = 0;
+  for (byte i = 0; i < CFI_LATENCY_BUCKETS; i++) {
+    count += _latency[i];
+    if (count >= limit) {
+      return 1ul << i;
+    }
+  }
+  return 1ul << (CFI_LATENCY_BUCKETS - 1);
+}
+
+void CFI_DigitalInputFeature::resetInterruptLatency()
+{
+  for (byte i = 0; i < CFI_LATENCY_BUCKETS; i++) {
+    _latency[i] = 0;
+  }
+}
+
+void CFI_DigitalInputFeature::interrupts()
+{
+  interruptsEnabled = true;
+  leaveCriticalSection();
+  dispatchEdges();
+}
+
 void CFI_DigitalInputFeature::noInterrupts()
 {
-    interruptsEnabled = false;
+  interruptsEnabled = false;
+  if (_threadRunning && _criticalOwner != std::this_thread::get_id()) {
+    // same order as the interrupt thread: the link, then the critical section
+    _firmata->lock();
+    _criticalSection.lock();
+    _criticalOwner = std::this_thread::get_id();
+  }
 }
 
+// Releases the critical section if the calling thread entered it
+void CFI_DigitalInputFeature::leaveCriticalSection()
+{
+  if (_criticalOwner == std::this_thread::get_id()) {
+    _criticalOwner = std::thread::id();
+    _criticalSection.unlock();
+    _firmata->unlock();
+  }
+}
@@ -13,6 +13,10 @@
 #ifndef CFI_DigitalInputFeature_h
 #define CFI_DigitalInputFeature_h
 
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "CFI_ClientFirmata.h"
 #include "CFI_ClientFirmataFeature.h"
 
@@ -20,6 +24,21 @@ class CFI_ClientFirmata;
 
 typedef void (*voidFuncPtr)(void);
 
+#if !defined(CFI_EDGE_QUEUE_SIZE)
+#define CFI_EDGE_QUEUE_SIZE 64 // pending interrupt edges, must be a power of two
+#endif
+
+#define CFI_DEBOUNCE_NONE 0 // pass the pin level unfiltered
+#define CFI_DEBOUNCE_TIME 1 // accept a level after it was stable for the debounce time
+#define CFI_DEBOUNCE_INTEGRATOR 2 // count up while high, down while low, switch at the limits
+
+#define CFI_PULSE_WAIT_IDLE 0 // the pin is still in the pulse state
+#define CFI_PULSE_WAIT_START 1
+#define CFI_PULSE_WAIT_END 2
+#define CFI_PULSE_DONE 3
+
+#define CFI_LATENCY_BUCKETS 24 // bucket n counts interrupt latencies below 2^n us
+
 class CFI_DigitalInputFeature : public CFI_ClientFirmataFeature
 {
   public:
@@ -28,23 +47,106 @@ class CFI_DigitalInputFeature : public CFI_ClientFirmataFeature
     void setPinMode(byte pin, int mode);
     bool getPinValue(byte pin);
     void setDigitalPort(byte port, int value);
+    void releasePin(byte pin);
+
+    void subscribePort(byte port);
+    void unsubscribePort(byte port);
+    void setReportIdleTimeout(unsigned long timeout);
+    void setDebounce(byte pin, byte mode, uint16_t time);
+    unsigned long pulseIn(byte pin, byte state, unsigned long timeout);
+    void beginPulse(byte pin, byte state);
+    bool pulseDone();
+    unsigned long endPulse();
 
     boolean handleSysex(byte command, int argc, byte* argv);
     void updateFeature();
+    boolean handlesSysex(byte command);
 
     void attachInterrupt(uint8_t interruptNum, void(*userFunc)(void), int mode);
     void detachInterrupt(uint8_t interruptNum);
     void interrupts();
     void noInterrupts();
+    uint32_t missedInterrupts(uint8_t interruptNum);
+    unsigned long interruptMicros();
+
+    void beginInterruptThread();
+    void endInterruptThread();
+    uint32_t interruptLatency(byte bucket);
+    unsigned long interruptLatencyPercentile(byte percent);
+    void resetInterruptLatency();
 
   private:
+    typedef struct {
+        unsigned long timestamp; // micros() when the port message was decoded
+        byte pin;
+        byte level;
+    } edge_t;
+
+    typedef struct {
+        byte mode; // CFI_DEBOUNCE_xxx
+        uint16_t time; // debounce time in ms, integrator limit
+        uint16_t count; // integrator state
+        unsigned long since; // millis() of the last stable or integrated level
+    } debounce_t;
+
     CFI_ClientFirmata *_firmata;
 	int _digitalPorts[16] = { 0 }; // all binary input ports
+	byte _inputPins[16] = { 0 }; // bit mask of the pins configured as input
+	byte _subscribers[16] = { 0 }; // number of consumers which keep the port reported
 	bool _reportPorts[16] = { false }; // 1 = report this port, 0 = silence
+	bool _pendingPorts[16] = { false }; // 1 = report switched on, no value received yet
+	unsigned long _lastRead[16] = { 0 }; // millis() of the last read access
+	unsigned long _reportIdleTimeout;
+	int _rawPorts[16] = { 0 }; // port values as received, before debouncing
+	byte _debounceMask[16] = { 0 }; // pins with a debounce filter
+	debounce_t _debounce[128];
+
+#if defined(EXTERNAL_NUM_INTERRUPTS)
+    // handlers of this board, another board's feature has its own
+    volatile int intMode[EXTERNAL_NUM_INTERRUPTS];
+    volatile int intPin[EXTERNAL_NUM_INTERRUPTS]; // digital pin of the interrupt, -1 = none
+    volatile uint32_t intMissed[EXTERNAL_NUM_INTERRUPTS]; // edges lost by queue overflow
+    volatile voidFuncPtr intFunc[EXTERNAL_NUM_INTERRUPTS];
+#endif // EXTERNAL_NUM_INTERRUPTS
+
+    byte _risingMask[16] = { 0 }; // pins with an interrupt on rising edges
+    byte _fallingMask[16] = { 0 }; // pins with an interrupt on falling edges
+    edge_t _edgeQueue[CFI_EDGE_QUEUE_SIZE];
+    volatile unsigned int _edgeHead = 0;
+    volatile unsigned int _edgeTail = 0;
+    volatile unsigned long _edgeMicros = 0;
+    bool _dispatching = false;
+
+    std::mutex _edgeMutex; // protects the edge queue
+    std::condition_variable _edgeSignal;
+    std::recursive_mutex _criticalSection; // held by noInterrupts() and the interrupt thread
+    std::atomic<std::thread::id> _criticalOwner; // thread which entered noInterrupts(), none = id()
+    std::thread _interruptThread;
+    volatile bool _threadRunning = false;
+    std::atomic<uint32_t> _latency[CFI_LATENCY_BUCKETS] = {}; // histogram of edge to handler delays, counted by the interrupt thread
 
     volatile bool interruptsEnabled = true;
 
-    void reportDigitalPort(byte port);
+    volatile int _pulsePin = -1; // pin measured by pulseIn(), -1 = none
+    byte _pulseState = 0;
+    volatile byte _pulsePhase = CFI_PULSE_DONE;
+    unsigned long _pulseStart = 0;
+    unsigned long _pulseEnd = 0;
+
+    bool isPortUsed(byte port);
+    void reportDigitalPort(byte port, bool enable);
+    void waitForPortValue(byte port);
+    void debouncePort(byte port);
+    void applyPort(byte port, int value);
+    void trackPulse(byte level);
+    int interruptToDigitalPin(uint8_t interruptNum);
+    void updateInterruptMasks();
+    void queueEdges(byte port, byte edges, int value);
+    void dispatchEdges();
+    bool popEdge(edge_t& edge);
+    void callHandler(const edge_t& edge);
+    void interruptThread();
+    void leaveCriticalSection();
 };
 
 #endif
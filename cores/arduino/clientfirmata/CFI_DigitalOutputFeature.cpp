@@ -39,13 +39,58 @@ void CFI_DigitalOutputFeature::digitalWritePort(byte port, int value)
   digitalPorts[port] = value;
 }
 
+// Bit-bangs the values with port messages for firmware without shift
+// support. The messages of each byte are combined into one write, a
+// clock falling edge is merged with the next data bit if both pins
+// share the port.
+void CFI_DigitalOutputFeature::shiftOut(byte dataPin, byte clockPin, byte bitOrder, const byte* values, size_t count)
+{
+  byte dataPort = (dataPin >> 3) & 0x0F;
+  byte dataBit = 1 << (dataPin & 0x07);
+  byte clockPort = (clockPin >> 3) & 0x0F;
+  byte clockBit = 1 << (clockPin & 0x07);
+  byte buffer[8 * 3 * 3];
+
+  for (size_t n = 0; n < count; n++) {
+    size_t size = 0;
+    for (byte i = 0; i < 8; i++) {
+      byte mask = bitOrder == 0 ? (1 << i) : (0x80 >> i); // LSBFIRST : MSBFIRST
+      if (values[n] & mask) {
+        digitalPorts[dataPort] |= dataBit;
+      } else {
+        digitalPorts[dataPort] &= ~dataBit;
+      }
+      size = appendPort(buffer, size, dataPort);
+      digitalPorts[clockPort] |= clockBit;
+      size = appendPort(buffer, size, clockPort);
+      digitalPorts[clockPort] &= ~clockBit;
+      if (clockPort != dataPort || i == 7) {
+        size = appendPort(buffer, size, clockPort);
+      }
+    }
+    _firmata->write(buffer, size);
+  }
+}
+
+size_t CFI_DigitalOutputFeature::appendPort(byte* buffer, size_t size, byte port)
+{
+  int value = digitalPorts[port];
+  buffer[size++] = (byte)(CFI_DIGITAL_MESSAGE | port);
+  buffer[size++] = (byte)(value & 0x7F);
+  buffer[size++] = (byte)(value >> 7 & 0x01);
+  return size;
+}
+
 void CFI_DigitalOutputFeature::setPinMode(byte pin, int mode)
 {
   _firmata->setPinMode(pin, mode);
 }
 
+// A single pin with SET_DIGITAL_PIN_VALUE: the board keeps the other pins of
+// the port, so levels set by a board-side sequence (PinSequence) survive.
 void CFI_DigitalOutputFeature::setPinValue(byte pin, bool value)
 {
+  byte message[3];
   int port = (pin >> 3) & 0x0F;
   if (value == 0) {
     digitalPorts[port] &= ~(1 << (pin & 0x07));
@@ -53,5 +98,8 @@ void CFI_DigitalOutputFeature::setPinValue(byte pin, bool value)
     digitalPorts[port] |= (1 << (pin & 0x07));
   }
 
-  digitalWritePort(port, digitalPorts[port]);
+  message[0] = CFI_SET_DIGITAL_PIN_VALUE;
+  message[1] = pin & 0x7F;
+  message[2] = value ? 1 : 0;
+  _firmata->write(message, 3);
 }
@@ -25,12 +25,16 @@ class CFI_DigitalOutputFeature : public CFI_ClientFirmataFeature
 
     void setPinMode(byte pin, int mode);
     void setPinValue(byte pin, bool value);
+    // Whole port messages, they also overwrite pins a board-side sequence drives
     void digitalWritePort(byte port, int value);
+    void shiftOut(byte dataPin, byte clockPin, byte bitOrder, const byte* values, size_t count);
 
     boolean handleSysex(byte command, int argc, byte* argv);
     void updateFeature();
 
   private:
+    size_t appendPort(byte* buffer, size_t size, byte port);
+
     CFI_ClientFirmata *_firmata;
 	int digitalPorts[16] = { 0 }; // all binary channels
 };
@@ -0,0 +1,190 @@
+/*
+  CFI_EncoderFeature.cpp - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#include "CFI_EncoderFeature.h"
+
+CFI_EncoderFeature::CFI_EncoderFeature(CFI_ClientFirmata& firmata) : _firmata(&firmata), _autoReport(true)
+{
+    _firmata->addFeature(*this);
+}
+
+// The board counts the quadrature edges itself, returns the encoder number
+// or -1 if all encoders are in use.
+int CFI_EncoderFeature::attach(byte pinA, byte pinB)
+{
+    byte encoderNum = 0;
+    while (encoderNum < CFI_MAX_ENCODERS && _attached[encoderNum]) {
+        encoderNum++;
+    }
+    if (encoderNum == CFI_MAX_ENCODERS) {
+        CFI_DEBUG_PRINTLN(F("Encoder: No free encoder"));
+        return -1;
+    }
+
+    byte buffer[7]{};
+
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_ENCODER_DATA;
+    buffer[2] = ENCODER_ATTACH;
+    buffer[3] = encoderNum;
+    buffer[4] = pinA & 0x7F;
+    buffer[5] = pinB & 0x7F;
+    buffer[6] = CFI_END_SYSEX;
+    _firmata->write(buffer, 7);
+
+    _attached[encoderNum] = true;
+    _positions[encoderNum] = 0;
+    _offsets[encoderNum] = 0;
+
+    // positions are reported with the sampling interval from now on
+    setAutoReport(_autoReport);
+    return encoderNum;
+}
+
+void CFI_EncoderFeature::detach(byte encoderNum)
+{
+    if (encoderNum >= CFI_MAX_ENCODERS || !_attached[encoderNum]) {
+        return;
+    }
+    sendCommand(ENCODER_DETACH, encoderNum);
+    _attached[encoderNum] = false;
+    _isAwaitingReply[encoderNum] = false;
+}
+
+long CFI_EncoderFeature::readPosition(byte encoderNum)
+{
+    if (encoderNum >= CFI_MAX_ENCODERS || !_attached[encoderNum]) {
+        return 0;
+    }
+    if (!_autoReport) {
+        requestPosition(encoderNum);
+    }
+    return _positions[encoderNum] + _offsets[encoderNum];
+}
+
+// The board can only reset its count, other positions are kept as offset
+void CFI_EncoderFeature::writePosition(byte encoderNum, long position)
+{
+    if (encoderNum >= CFI_MAX_ENCODERS || !_attached[encoderNum]) {
+        return;
+    }
+    sendCommand(ENCODER_RESET_POSITION, encoderNum);
+    _positions[encoderNum] = 0;
+    _offsets[encoderNum] = position;
+}
+
+// Round-trip for the current position, e.g. while auto reporting is off
+void CFI_EncoderFeature::requestPosition(byte encoderNum)
+{
+    if (encoderNum >= CFI_MAX_ENCODERS || !_attached[encoderNum]) {
+        return;
+    }
+    _isAwaitingReply[encoderNum] = true;
+    sendCommand(ENCODER_REPORT_POSITION, encoderNum);
+
+    unsigned long startMicros = micros();
+    while (_isAwaitingReply[encoderNum]) {
+        unsigned long elapsed = micros() - startMicros;
+        if (elapsed >= CFI_ENCODER_REPLY_TIMEOUT * 1000UL) {
+            break;
+        }
+        _firmata->update();
+        if (_isAwaitingReply[encoderNum]) {
+            _firmata->waitForInput(CFI_ENCODER_REPLY_TIMEOUT * 1000UL - elapsed);
+        }
+    }
+    if (_isAwaitingReply[encoderNum]) {
+        CFI_DEBUG_PRINTLN(F("Encoder: Position request timed out"));
+        _isAwaitingReply[encoderNum] = false;
+    }
+}
+
+void CFI_EncoderFeature::setAutoReport(bool enable)
+{
+    _autoReport = enable;
+
+    byte buffer[5]{};
+
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_ENCODER_DATA;
+    buffer[2] = ENCODER_REPORT_AUTO;
+    buffer[3] = enable ? 1 : 0;
+    buffer[4] = CFI_END_SYSEX;
+    _firmata->write(buffer, 5);
+}
+
+void CFI_EncoderFeature::sendCommand(byte command, byte encoderNum)
+{
+    byte buffer[5]{};
+
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_ENCODER_DATA;
+    buffer[2] = command;
+    buffer[3] = encoderNum;
+    buffer[4] = CFI_END_SYSEX;
+    _firmata->write(buffer, 5);
+}
+
+void CFI_EncoderFeature::setPinMode(byte pin, int mode)
+{
+    _firmata->setPinMode(pin, mode);
+}
+
+boolean CFI_EncoderFeature::handleSysex(byte command, int argc, byte* argv)
+{
+    switch (command) {
+    case CFI_ENCODER_DATA:
+        handleEncoderReply(argc, argv);
+        return true;
+    }
+    return false;
+}
+
+// One or more positions of 5 bytes each:
+// [direction << 6 | encoder number] followed by 28 bits, LSB first
+void CFI_EncoderFeature::handleEncoderReply(byte argc, byte* argv)
+{
+    if (argc % 5 != 0) {
+        CFI_DEBUG_PRINT(F("Encoder reply: Wrong message length: "));
+        CFI_DEBUG_PRINTLN(argc);
+        return;
+    }
+    for (byte i = 0; i < argc; i += 5) {
+        byte encoderNum = argv[i] & 0x3F;
+        if (encoderNum >= CFI_MAX_ENCODERS) {
+            CFI_DEBUG_PRINT(F("Encoder reply: Unknown encoder: "));
+            CFI_DEBUG_PRINTLN(encoderNum);
+            continue;
+        }
+        long position = (long)argv[i + 1] | (long)argv[i + 2] << 7 |
+                        (long)argv[i + 3] << 14 | (long)argv[i + 4] << 21;
+        if (argv[i] & 0x40) {
+            position = -position;
+        }
+        _positions[encoderNum] = position;
+        _isAwaitingReply[encoderNum] = false;
+    }
+}
+
+void CFI_EncoderFeature::updateFeature()
+{
+}
+
+boolean CFI_EncoderFeature::handlesSysex(byte command)
+{
+    return command == CFI_ENCODER_DATA;
+}
+
+boolean CFI_EncoderFeature::hasUpdate()
+{
+    return false;
+}
@@ -0,0 +1,65 @@
+/*
+  CFI_EncoderFeature.h - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#ifndef CFI_EncoderFeature_h
+#define CFI_EncoderFeature_h
+
+#include "CFI_ClientFirmata.h"
+#include "CFI_ClientFirmataFeature.h"
+
+#define ENCODER_ATTACH              0x00
+#define ENCODER_REPORT_POSITION     0x01
+#define ENCODER_REPORT_POSITIONS    0x02
+#define ENCODER_RESET_POSITION      0x03
+#define ENCODER_REPORT_AUTO         0x04
+#define ENCODER_DETACH              0x05
+
+#define CFI_MAX_ENCODERS 5 // same limit as FirmataEncoder on the board
+
+#if !defined(CFI_ENCODER_REPLY_TIMEOUT)
+#define CFI_ENCODER_REPLY_TIMEOUT 100 // ms to wait for a requested position
+#endif
+
+class CFI_ClientFirmata;
+
+class CFI_EncoderFeature : public CFI_ClientFirmataFeature
+{
+public:
+    CFI_EncoderFeature(CFI_ClientFirmata& firmata);
+
+    int attach(byte pinA, byte pinB);
+    void detach(byte encoderNum);
+    long readPosition(byte encoderNum);
+    void writePosition(byte encoderNum, long position);
+    void requestPosition(byte encoderNum);
+    void setAutoReport(bool enable);
+
+    void setPinMode(byte pin, int mode);
+    boolean handleSysex(byte command, int argc, byte* argv);
+    void updateFeature();
+    boolean handlesSysex(byte command);
+    boolean hasUpdate();
+
+private:
+    void sendCommand(byte command, byte encoderNum);
+    void handleEncoderReply(byte argc, byte* argv);
+
+    CFI_ClientFirmata* _firmata;
+
+    bool _attached[CFI_MAX_ENCODERS] = { false };
+    volatile long _positions[CFI_MAX_ENCODERS] = { 0 }; // last position reported by the board
+    long _offsets[CFI_MAX_ENCODERS] = { 0 }; // position set by writePosition() at the board's zero
+    volatile bool _isAwaitingReply[CFI_MAX_ENCODERS] = { false };
+    bool _autoReport;
+};
+
+#endif
@@ -45,6 +45,11 @@
 #endif
 #define CFI_SET_PIN_MODE             clientFirmataInternal::SET_PIN_MODE // set a pin to INPUT/OUTPUT/PWM/etc
 
+#ifdef CFI_SET_DIGITAL_PIN_VALUE
+#undef CFI_SET_DIGITAL_PIN_VALUE
+#endif
+#define CFI_SET_DIGITAL_PIN_VALUE    clientFirmataInternal::SET_DIGITAL_PIN_VALUE // set value of an individual digital pin
+
 //
 
 #ifdef CFI_REPORT_VERSION
@@ -74,6 +79,16 @@
 // extended command set using sysex (0-127/0x00-0x7F)
 /* 0x00-0x0F reserved for user-defined commands */
 
+#ifdef CFI_ENCODER_DATA
+#undef CFI_ENCODER_DATA
+#endif
+#define CFI_ENCODER_DATA             clientFirmataInternal::ENCODER_DATA // reply with encoders current positions
+
+#ifdef CFI_ACCELSTEPPER_DATA
+#undef CFI_ACCELSTEPPER_DATA
+#endif
+#define CFI_ACCELSTEPPER_DATA        clientFirmataInternal::ACCELSTEPPER_DATA // control a stepper motor
+
 #ifdef CFI_SPI_DATA
 #undef CFI_SPI_DATA
 #endif
@@ -89,6 +104,16 @@
 #endif
 #define CFI_STRING_DATA              clientFirmataInternal::STRING_DATA // a string message with 14-bits per char
 
+#ifdef CFI_ONEWIRE_DATA
+#undef CFI_ONEWIRE_DATA
+#endif
+#define CFI_ONEWIRE_DATA             clientFirmataInternal::ONEWIRE_DATA // send an OneWire read/write/reset/select/skip/search request
+
+#ifdef CFI_SHIFT_DATA
+#undef CFI_SHIFT_DATA
+#endif
+#define CFI_SHIFT_DATA               clientFirmataInternal::SHIFT_DATA // a bitstream to/from a shift register
+
 #ifdef CFI_I2C_REQUEST
 #undef CFI_I2C_REQUEST
 #endif
@@ -149,6 +174,11 @@
 #endif
 #define CFI_SAMPLING_INTERVAL        clientFirmataInternal::SAMPLING_INTERVAL // set the poll rate of the main loop
 
+#ifdef CFI_SCHEDULER_DATA
+#undef CFI_SCHEDULER_DATA
+#endif
+#define CFI_SCHEDULER_DATA           clientFirmataInternal::SCHEDULER_DATA // send a createtask/deletetask/addtotask/schedule/querytasks/querytask request to the scheduler
+
 // pin modes
 
 #ifdef CFI_PIN_MODE_INPUT
@@ -186,6 +216,21 @@
 #endif
 #define CFI_PIN_MODE_I2C             clientFirmataInternal::PIN_MODE_I2C // pin included in I2C setup
 
+#ifdef CFI_PIN_MODE_ONEWIRE
+#undef CFI_PIN_MODE_ONEWIRE
+#endif
+#define CFI_PIN_MODE_ONEWIRE         clientFirmataInternal::PIN_MODE_ONEWIRE // pin configured for 1-wire
+
+#ifdef CFI_PIN_MODE_STEPPER
+#undef CFI_PIN_MODE_STEPPER
+#endif
+#define CFI_PIN_MODE_STEPPER         clientFirmataInternal::PIN_MODE_STEPPER // pin configured for stepper motor
+
+#ifdef CFI_PIN_MODE_ENCODER
+#undef CFI_PIN_MODE_ENCODER
+#endif
+#define CFI_PIN_MODE_ENCODER         clientFirmataInternal::PIN_MODE_ENCODER // pin configured for rotary encoders
+
 #ifdef CFI_PIN_MODE_PULLUP
 #undef CFI_PIN_MODE_PULLUP
 #endif
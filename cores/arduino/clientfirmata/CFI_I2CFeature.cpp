@@ -148,3 +148,13 @@ void CFI_I2CFeature::handleI2cReply(byte argc, byte* argv)
 void CFI_I2CFeature::updateFeature()
 {
 }
+
+boolean CFI_I2CFeature::handlesSysex(byte command)
+{
+    return command == CFI_I2C_REPLY;
+}
+
+boolean CFI_I2CFeature::hasUpdate()
+{
+    return false;
+}
@@ -43,6 +43,8 @@ public:
     void setPinMode(byte pin, int mode);
     boolean handleSysex(byte command, int argc, byte* argv);
     void updateFeature();
+    boolean handlesSysex(byte command);
+    boolean hasUpdate();
 
 private:
     void handleI2cReply(byte argc, byte* argv);
@@ -0,0 +1,334 @@
+/*
+  CFI_OneWireFeature.cpp - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#include "CFI_OneWireFeature.h"
+#include "CFI_ClientEncoder7Bit.h"
+
+// Execution order of the request bits on the board
+static const byte oneWireStages[] = {
+    ONEWIRE_RESET_REQUEST_BIT,
+    ONEWIRE_SKIP_REQUEST_BIT,
+    ONEWIRE_SELECT_REQUEST_BIT,
+    ONEWIRE_WRITE_REQUEST_BIT,
+    ONEWIRE_READ_REQUEST_BIT,
+    ONEWIRE_DELAY_REQUEST_BIT
+};
+
+// 1-based position of the last stage in the command, 0 if none
+static byte oneWireLastStage(byte command)
+{
+    for (byte i = sizeof(oneWireStages); i > 0; i--) {
+        if (command & oneWireStages[i - 1]) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+CFI_OneWireFeature::CFI_OneWireFeature(CFI_ClientFirmata& firmata) : _firmata(&firmata), _pin(0), _command(0),
+    _writeCount(0), _isAwaitingReply(false), _correlationId(0), _readBuffer(NULL), _readCount(0),
+    _searchBuffer(NULL), _searchMax(0), _searchCount(0)
+{
+    memset(_header, 0, sizeof(_header));
+    _firmata->addFeature(*this);
+}
+
+// Also switches the pin to 1-wire mode. With power the board keeps the
+// line driven high after a write, e.g. for parasite powered devices.
+void CFI_OneWireFeature::config(byte pin, bool power)
+{
+    flush();
+
+    byte buffer[6]{};
+
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_ONEWIRE_DATA;
+    buffer[2] = ONEWIRE_CONFIG_REQUEST;
+    buffer[3] = pin & 0x7F;
+    buffer[4] = power ? 1 : 0;
+    buffer[5] = CFI_END_SYSEX;
+    _firmata->write(buffer, 6);
+}
+
+// The board runs the whole search and replies with all addresses at once,
+// returns the number of addresses copied (8 bytes each).
+byte CFI_OneWireFeature::search(byte pin, byte* addresses, byte maxDevices, bool alarms)
+{
+    flush();
+
+    _searchBuffer = addresses;
+    _searchMax = maxDevices;
+    _searchCount = 0;
+
+    byte buffer[5]{};
+
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_ONEWIRE_DATA;
+    buffer[2] = alarms ? ONEWIRE_SEARCH_ALARMS_REQUEST : ONEWIRE_SEARCH_REQUEST;
+    buffer[3] = pin & 0x7F;
+    buffer[4] = CFI_END_SYSEX;
+    _isAwaitingReply = true;
+    _firmata->write(buffer, 5);
+
+    waitForReply();
+    _searchBuffer = NULL;
+    return _searchCount;
+}
+
+void CFI_OneWireFeature::reset(byte pin)
+{
+    beginTransaction(pin, ONEWIRE_RESET_REQUEST_BIT);
+}
+
+void CFI_OneWireFeature::skip(byte pin)
+{
+    beginTransaction(pin, ONEWIRE_SKIP_REQUEST_BIT);
+}
+
+void CFI_OneWireFeature::select(byte pin, const byte* address)
+{
+    beginTransaction(pin, ONEWIRE_SELECT_REQUEST_BIT);
+    memcpy(_header, address, 8);
+}
+
+void CFI_OneWireFeature::write(byte pin, const byte* data, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (_writeCount == ONEWIRE_MAX_WRITE) {
+            sendTransaction();
+        }
+        beginTransaction(pin, ONEWIRE_WRITE_REQUEST_BIT);
+        _writeData[_writeCount++] = data[i];
+    }
+}
+
+// Sends the collected commands together with the read and waits for the data
+bool CFI_OneWireFeature::read(byte pin, byte* data, size_t count)
+{
+    size_t offset = 0;
+    while (offset < count) {
+        size_t numBytes = count - offset;
+        if (numBytes > ONEWIRE_MAX_READ) {
+            numBytes = ONEWIRE_MAX_READ;
+        }
+        beginTransaction(pin, ONEWIRE_READ_REQUEST_BIT);
+        _correlationId = (_correlationId + 1) & 0x3FFF;
+        _header[8] = numBytes & 0xFF;
+        _header[9] = (numBytes >> 8) & 0xFF;
+        _header[10] = _correlationId & 0xFF;
+        _header[11] = (_correlationId >> 8) & 0xFF;
+
+        _readBuffer = data + offset;
+        _readCount = numBytes;
+        _isAwaitingReply = true;
+        sendTransaction();
+        bool received = waitForReply();
+        _readBuffer = NULL;
+        if (!received) {
+            return false;
+        }
+        offset += numBytes;
+    }
+    return true;
+}
+
+// Sent with the other commands of the transaction; OneWireFirmata only
+// pauses (Firmata.delayTask) when the transaction runs in a scheduler task.
+void CFI_OneWireFeature::delay(byte pin, unsigned long ms)
+{
+    beginTransaction(pin, ONEWIRE_DELAY_REQUEST_BIT);
+    _header[12] = ms & 0xFF;
+    _header[13] = (ms >> 8) & 0xFF;
+    _header[14] = (ms >> 16) & 0xFF;
+    _header[15] = (ms >> 24) & 0xFF;
+}
+
+void CFI_OneWireFeature::flush()
+{
+    sendTransaction();
+}
+
+// Commands are merged into one message as long as the board would
+// execute them in the order they were requested.
+void CFI_OneWireFeature::beginTransaction(byte pin, byte command)
+{
+    if (_command != 0) {
+        byte stage = oneWireLastStage(command);
+        byte lastStage = oneWireLastStage(_command);
+        if (pin != _pin || stage < lastStage ||
+            (stage == lastStage && command != ONEWIRE_WRITE_REQUEST_BIT)) {
+            sendTransaction();
+        }
+    }
+    _pin = pin;
+    _command |= command;
+}
+
+void CFI_OneWireFeature::sendTransaction()
+{
+    if (_command == 0) {
+        return;
+    }
+
+    // the board reads a header field only if its bit is set and writes
+    // everything behind them to the bus
+    byte data[ONEWIRE_HEADER_SIZE + ONEWIRE_MAX_WRITE];
+    int dataSize = 0;
+    if (_command & ONEWIRE_SELECT_REQUEST_BIT) {
+        memcpy(data + dataSize, _header, 8);
+        dataSize += 8;
+    }
+    if (_command & ONEWIRE_READ_REQUEST_BIT) {
+        memcpy(data + dataSize, _header + 8, 4);
+        dataSize += 4;
+    }
+    if (_command & ONEWIRE_DELAY_REQUEST_BIT) {
+        memcpy(data + dataSize, _header + 12, 4);
+        dataSize += 4;
+    }
+    memcpy(data + dataSize, _writeData, _writeCount);
+    dataSize += _writeCount;
+
+    byte buffer[(ONEWIRE_HEADER_SIZE + ONEWIRE_MAX_WRITE) * 8 / 7 + 6];
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_ONEWIRE_DATA;
+    buffer[2] = _command;
+    buffer[3] = _pin & 0x7F;
+
+    CFI_ClientEncoder7BitClass encoder;
+    encoder.startBinaryWrite(buffer, 4);
+    for (int i = 0; i < dataSize; i++) {
+        encoder.writeBinary(data[i]);
+    }
+    int size = encoder.endBinaryWrite();
+    buffer[size++] = CFI_END_SYSEX;
+    _firmata->write(buffer, size);
+
+    _command = 0;
+    _writeCount = 0;
+    memset(_header, 0, sizeof(_header));
+}
+
+bool CFI_OneWireFeature::waitForReply()
+{
+    unsigned long startMicros = micros();
+    while (_isAwaitingReply) {
+        unsigned long elapsed = micros() - startMicros;
+        if (elapsed >= CFI_ONEWIRE_REPLY_TIMEOUT * 1000UL) {
+            break;
+        }
+        _firmata->update();
+        if (_isAwaitingReply) {
+            _firmata->waitForInput(CFI_ONEWIRE_REPLY_TIMEOUT * 1000UL - elapsed);
+        }
+    }
+    if (_isAwaitingReply) {
+        CFI_DEBUG_PRINTLN(F("OneWire: Reply timed out"));
+        _isAwaitingReply = false;
+        return false;
+    }
+    return true;
+}
+
+void CFI_OneWireFeature::setPinMode(byte pin, int mode)
+{
+    _firmata->setPinMode(pin, mode);
+}
+
+boolean CFI_OneWireFeature::handleSysex(byte command, int argc, byte* argv)
+{
+    switch (command) {
+    case CFI_ONEWIRE_DATA:
+        if (argc < 2)
+        {
+            CFI_DEBUG_PRINTLN(F("OneWire reply: Empty message error"));
+            return false;
+        }
+        switch (argv[0]) {
+        case ONEWIRE_SEARCH_REPLY:
+        case ONEWIRE_SEARCH_ALARMS_REPLY:
+            handleSearchReply(argc - 2, argv + 2);
+            break;
+        case ONEWIRE_READ_REPLY:
+            handleReadReply(argc - 2, argv + 2);
+            break;
+        default:
+            CFI_DEBUG_PRINT(F("OneWire reply: Unknown command: "));
+            CFI_DEBUG_PRINTLN(argv[0]);
+            break;
+        }
+        return true;
+    }
+    return false;
+}
+
+void CFI_OneWireFeature::handleSearchReply(byte argc, byte* argv)
+{
+    if (!_isAwaitingReply || _searchBuffer == NULL) {
+        CFI_DEBUG_PRINTLN(F("OneWire reply: Not awaiting search reply"));
+        return;
+    }
+    _isAwaitingReply = false;
+
+    byte devices = num7BitOutbytes(argc) / 8;
+    if (devices > _searchMax) {
+        devices = _searchMax;
+    }
+    CFI_ClientEncoder7BitClass::readBinary(devices * 8, argv, _searchBuffer);
+    _searchCount = devices;
+}
+
+// Decoded reply: correlation id (2 bytes) followed by the data
+void CFI_OneWireFeature::handleReadReply(byte argc, byte* argv)
+{
+    if (!_isAwaitingReply || _readBuffer == NULL) {
+        CFI_DEBUG_PRINTLN(F("OneWire reply: Not awaiting read reply"));
+        return;
+    }
+
+    byte data[2 + ONEWIRE_MAX_READ];
+    int numBytes = num7BitOutbytes(argc);
+    if (numBytes > (int)sizeof(data)) {
+        numBytes = sizeof(data);
+    }
+    if (numBytes < 2) {
+        CFI_DEBUG_PRINTLN(F("OneWire reply: Message too short"));
+        return;
+    }
+    CFI_ClientEncoder7BitClass::readBinary(numBytes, argv, data);
+
+    uint16_t correlationId = data[0] | (data[1] << 8);
+    if (correlationId != _correlationId) {
+        CFI_DEBUG_PRINT(F("OneWire reply: Unknown correlation id: "));
+        CFI_DEBUG_PRINTLN(correlationId);
+        return;
+    }
+    _isAwaitingReply = false;
+
+    size_t count = numBytes - 2;
+    if (count > _readCount) {
+        count = _readCount;
+    }
+    memcpy(_readBuffer, data + 2, count);
+}
+
+// Commands not followed by a read are sent with the next update,
+// e.g. the delay() after starting a temperature conversion.
+void CFI_OneWireFeature::updateFeature()
+{
+    flush();
+}
+
+boolean CFI_OneWireFeature::handlesSysex(byte command)
+{
+    return command == CFI_ONEWIRE_DATA;
+}
@@ -0,0 +1,92 @@
+/*
+  CFI_OneWireFeature.h - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#ifndef CFI_OneWireFeature_h
+#define CFI_OneWireFeature_h
+
+#include "CFI_ClientFirmata.h"
+#include "CFI_ClientFirmataFeature.h"
+
+#define ONEWIRE_SEARCH_REQUEST          0x40
+#define ONEWIRE_CONFIG_REQUEST          0x41
+#define ONEWIRE_SEARCH_REPLY            0x42
+#define ONEWIRE_READ_REPLY              0x43
+#define ONEWIRE_SEARCH_ALARMS_REQUEST   0x44
+#define ONEWIRE_SEARCH_ALARMS_REPLY     0x45
+
+// Bits of a transaction request, the board executes them in this order:
+// reset, skip, select, write, read, delay
+#define ONEWIRE_RESET_REQUEST_BIT       0x01
+#define ONEWIRE_SKIP_REQUEST_BIT        0x02
+#define ONEWIRE_SELECT_REQUEST_BIT      0x04
+#define ONEWIRE_READ_REQUEST_BIT        0x08
+#define ONEWIRE_DELAY_REQUEST_BIT       0x10
+#define ONEWIRE_WRITE_REQUEST_BIT       0x20
+
+#define ONEWIRE_HEADER_SIZE 16 // address, bytes to read, correlation id, delay
+#define ONEWIRE_MAX_WRITE 32 // bytes to write per transaction, limited by the board's sysex buffer
+#define ONEWIRE_MAX_READ 32 // bytes to read per transaction
+#define ONEWIRE_MAX_DEVICES 8 // addresses kept from a search
+
+#if !defined(CFI_ONEWIRE_REPLY_TIMEOUT)
+#define CFI_ONEWIRE_REPLY_TIMEOUT 1000 // ms to wait for a search or read reply
+#endif
+
+class CFI_ClientFirmata;
+
+class CFI_OneWireFeature : public CFI_ClientFirmataFeature
+{
+public:
+    CFI_OneWireFeature(CFI_ClientFirmata& firmata);
+
+    void config(byte pin, bool power);
+    byte search(byte pin, byte* addresses, byte maxDevices, bool alarms);
+
+    void reset(byte pin);
+    void skip(byte pin);
+    void select(byte pin, const byte* address);
+    void write(byte pin, const byte* data, size_t count);
+    bool read(byte pin, byte* data, size_t count);
+    void delay(byte pin, unsigned long ms);
+    void flush();
+
+    void setPinMode(byte pin, int mode);
+    boolean handleSysex(byte command, int argc, byte* argv);
+    void updateFeature();
+    boolean handlesSysex(byte command);
+
+private:
+    void beginTransaction(byte pin, byte command);
+    void sendTransaction();
+    bool waitForReply();
+    void handleSearchReply(byte argc, byte* argv);
+    void handleReadReply(byte argc, byte* argv);
+
+    CFI_ClientFirmata* _firmata;
+
+    // commands collected until a read, another pin or the next update
+    byte _pin;
+    byte _command;
+    byte _header[ONEWIRE_HEADER_SIZE];
+    byte _writeData[ONEWIRE_MAX_WRITE];
+    byte _writeCount;
+
+    volatile bool _isAwaitingReply;
+    uint16_t _correlationId;
+    byte* _readBuffer;
+    size_t _readCount;
+    byte* _searchBuffer;
+    byte _searchMax;
+    byte _searchCount;
+};
+
+#endif
@@ -0,0 +1,106 @@
+/*
+  CFI_PingFeature.cpp - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#include "CFI_PingFeature.h"
+
+CFI_PingFeature::CFI_PingFeature(CFI_ClientFirmata& firmata) : _firmata(&firmata), _isAwaitingReply(false),
+    _pin(0), _duration(0)
+{
+    _firmata->addFeature(*this);
+}
+
+// The board sends a trigger pulse on the pin, then measures the echo pulse
+// with its pulseIn(). Returns the length in microseconds, 0 on timeout.
+unsigned long CFI_PingFeature::pingRead(byte pin, byte state, unsigned long triggerMicros, unsigned long timeout)
+{
+    unsigned long values[2] = { triggerMicros, timeout };
+    byte buffer[21];
+    size_t size = 0;
+
+    buffer[size++] = CFI_START_SYSEX;
+    buffer[size++] = CFI_PING_READ;
+    buffer[size++] = pin & 0x7F;
+    buffer[size++] = state ? 1 : 0;
+    for (byte i = 0; i < 2; i++) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            byte value = (values[i] >> shift) & 0xFF;
+            buffer[size++] = value & 0x7F;
+            buffer[size++] = value >> 7;
+        }
+    }
+    buffer[size++] = CFI_END_SYSEX;
+
+    _pin = pin;
+    _duration = 0;
+    _isAwaitingReply = true;
+    _firmata->write(buffer, size);
+
+    // the board blocks for up to the timeout before it replies
+    unsigned long startMicros = micros();
+    unsigned long replyTimeout = timeout + 1000ul * CFI_REPORT_RESUME_TIMEOUT;
+    while (_isAwaitingReply) {
+        unsigned long elapsed = micros() - startMicros;
+        if (elapsed >= replyTimeout) {
+            CFI_DEBUG_PRINTLN(F("Ping: Reply timed out"));
+            _isAwaitingReply = false;
+            break;
+        }
+        _firmata->update();
+        if (_isAwaitingReply) {
+            _firmata->waitForInput(replyTimeout - elapsed);
+        }
+    }
+    return _duration;
+}
+
+void CFI_PingFeature::setPinMode(byte pin, int mode)
+{
+    _firmata->setPinMode(pin, mode);
+}
+
+boolean CFI_PingFeature::handleSysex(byte command, int argc, byte* argv)
+{
+    if (command != CFI_PING_READ || !_isAwaitingReply) {
+        return false;
+    }
+    if (argc < 10) {
+        CFI_DEBUG_PRINTLN(F("Ping reply: Message too short"));
+        return false;
+    }
+    byte pin = (argv[0] & 0x7F) | (argv[1] << 7);
+    if (pin != _pin) {
+        CFI_DEBUG_PRINT(F("Ping reply: Unknown pin: "));
+        CFI_DEBUG_PRINTLN(pin);
+        return true;
+    }
+    unsigned long duration = 0;
+    for (byte i = 0; i < 4; i++) {
+        duration = (duration << 8) | (byte)((argv[2 + 2 * i] & 0x7F) | (argv[3 + 2 * i] << 7));
+    }
+    _duration = duration;
+    _isAwaitingReply = false;
+    return true;
+}
+
+void CFI_PingFeature::updateFeature()
+{
+}
+
+boolean CFI_PingFeature::handlesSysex(byte command)
+{
+    return command == CFI_PING_READ;
+}
+
+boolean CFI_PingFeature::hasUpdate()
+{
+    return false;
+}
@@ -0,0 +1,47 @@
+/*
+  CFI_PingFeature.h - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#ifndef CFI_PingFeature_h
+#define CFI_PingFeature_h
+
+#include "CFI_ClientFirmata.h"
+#include "CFI_ClientFirmataFeature.h"
+
+// PingFirmata (ultrasonic sensors) reuses the command byte of SHIFT_DATA:
+// PING_READ pin state {trigger micros, timeout micros as 8 bytes big endian, 2 x 7 bit each}
+// reply PING_READ {pin as 2 x 7 bit} {duration as 4 bytes big endian, 2 x 7 bit each}
+#define CFI_PING_READ 0x75
+
+class CFI_ClientFirmata;
+
+class CFI_PingFeature : public CFI_ClientFirmataFeature
+{
+public:
+    CFI_PingFeature(CFI_ClientFirmata& firmata);
+
+    unsigned long pingRead(byte pin, byte state, unsigned long triggerMicros, unsigned long timeout);
+
+    void setPinMode(byte pin, int mode);
+    boolean handleSysex(byte command, int argc, byte* argv);
+    void updateFeature();
+    boolean handlesSysex(byte command);
+    boolean hasUpdate();
+
+private:
+    CFI_ClientFirmata* _firmata;
+
+    volatile bool _isAwaitingReply;
+    byte _pin;
+    unsigned long _duration;
+};
+
+#endif
@@ -175,3 +175,13 @@ void CFI_SPIFeature::handleSpiReply(byte argc, byte* argv)
 void CFI_SPIFeature::updateFeature()
 {
 }
+
+boolean CFI_SPIFeature::handlesSysex(byte command)
+{
+    return command == CFI_SPI_DATA;
+}
+
+boolean CFI_SPIFeature::hasUpdate()
+{
+    return false;
+}
@@ -48,6 +48,8 @@ public:
     void setPinMode(byte pin, int mode);
     boolean handleSysex(byte command, int argc, byte* argv);
     void updateFeature();
+    boolean handlesSysex(byte command);
+    boolean hasUpdate();
 
 private:
     void handleSpiResponse(byte command, byte argc, byte* argv);
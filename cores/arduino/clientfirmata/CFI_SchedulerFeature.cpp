@@ -0,0 +1,245 @@
+/*
+  CFI_SchedulerFeature.cpp - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#include "CFI_SchedulerFeature.h"
+#include "CFI_ClientEncoder7Bit.h"
+
+// Sysex with an optional task id followed by a 7-bit encoded 32 bit value
+static size_t encodeSchedulerMessage(byte command, int taskId, unsigned long value, byte* buffer)
+{
+    size_t size = 0;
+    buffer[size++] = CFI_START_SYSEX;
+    buffer[size++] = CFI_SCHEDULER_DATA;
+    buffer[size++] = command;
+    if (taskId >= 0) {
+        buffer[size++] = taskId & 0x7F;
+    }
+    CFI_ClientEncoder7BitClass encoder;
+    encoder.startBinaryWrite(buffer, size);
+    for (byte i = 0; i < 4; i++) {
+        encoder.writeBinary((value >> (8 * i)) & 0xFF);
+    }
+    size = encoder.endBinaryWrite();
+    buffer[size++] = CFI_END_SYSEX;
+    return size;
+}
+
+CFI_SchedulerTask::CFI_SchedulerTask()
+{
+    clear();
+}
+
+void CFI_SchedulerTask::clear()
+{
+    _size = 0;
+    _overflow = false;
+}
+
+void CFI_SchedulerTask::pinMode(byte pin, byte mode)
+{
+    byte message[3];
+
+    message[0] = CFI_SET_PIN_MODE;
+    message[1] = pin & 0x7F;
+    message[2] = mode & 0x7F;
+    append(message, 3);
+}
+
+// A single pin, the board keeps the other pins of the port
+void CFI_SchedulerTask::digitalWrite(byte pin, bool value)
+{
+    byte message[3];
+
+    message[0] = CFI_SET_DIGITAL_PIN_VALUE;
+    message[1] = pin & 0x7F;
+    message[2] = value ? 1 : 0;
+    append(message, 3);
+}
+
+void CFI_SchedulerTask::analogWrite(byte pin, int value)
+{
+    byte message[3];
+
+    if (pin < 16) {
+        message[0] = (byte)(CFI_ANALOG_MESSAGE | pin);
+        message[1] = (byte)(value & 0x7F);
+        message[2] = (byte)((value >> 7) & 0x7F);
+        append(message, 3);
+        return;
+    }
+    byte extended[6];
+    extended[0] = CFI_START_SYSEX;
+    extended[1] = CFI_EXTENDED_ANALOG;
+    extended[2] = pin & 0x7F;
+    extended[3] = (byte)(value & 0x7F);
+    extended[4] = (byte)((value >> 7) & 0x7F);
+    extended[5] = CFI_END_SYSEX;
+    append(extended, 6);
+}
+
+// The board's scheduler delays with millisecond resolution
+void CFI_SchedulerTask::delay(unsigned long ms)
+{
+    byte message[9];
+    append(message, encodeSchedulerMessage(DELAY_FIRMATA_TASK, -1, ms, message));
+}
+
+// Runs a task, e.g. the task itself again for a repeated sequence
+void CFI_SchedulerTask::schedule(byte taskId, unsigned long ms)
+{
+    byte message[10];
+    append(message, encodeSchedulerMessage(SCHEDULE_FIRMATA_TASK, taskId, ms, message));
+}
+
+void CFI_SchedulerTask::append(const byte* message, size_t size)
+{
+    if (_size + size > CFI_TASK_MAX_SIZE) {
+        _overflow = true;
+        return;
+    }
+    memcpy(_data + _size, message, size);
+    _size += size;
+}
+
+CFI_SchedulerFeature::CFI_SchedulerFeature(CFI_ClientFirmata& firmata) : _firmata(&firmata), _taskErrors(0)
+{
+    _firmata->addFeature(*this);
+}
+
+// Uploads the task to the board once, returns the task id or -1
+int CFI_SchedulerFeature::createTask(const CFI_SchedulerTask& task)
+{
+    if (task.overflow() || task.size() == 0) {
+        CFI_DEBUG_PRINTLN(F("Scheduler: Task empty or too long"));
+        return -1;
+    }
+    byte taskId = 0;
+    while (taskId < 128 && _usedTasks[taskId]) {
+        taskId++;
+    }
+    if (taskId == 128) {
+        CFI_DEBUG_PRINTLN(F("Scheduler: No free task id"));
+        return -1;
+    }
+    _usedTasks[taskId] = true;
+
+    byte buffer[SCHEDULER_MAX_CHUNK * 8 / 7 + 6];
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_SCHEDULER_DATA;
+    buffer[2] = CREATE_FIRMATA_TASK;
+    buffer[3] = taskId;
+    buffer[4] = task.size() & 0x7F;
+    buffer[5] = (task.size() >> 7) & 0x7F;
+    buffer[6] = CFI_END_SYSEX;
+    _firmata->write(buffer, 7);
+
+    for (size_t offset = 0; offset < task.size(); offset += SCHEDULER_MAX_CHUNK) {
+        size_t chunk = task.size() - offset;
+        if (chunk > SCHEDULER_MAX_CHUNK) {
+            chunk = SCHEDULER_MAX_CHUNK;
+        }
+        buffer[0] = CFI_START_SYSEX;
+        buffer[1] = CFI_SCHEDULER_DATA;
+        buffer[2] = ADD_TO_FIRMATA_TASK;
+        buffer[3] = taskId;
+
+        CFI_ClientEncoder7BitClass encoder;
+        encoder.startBinaryWrite(buffer, 4);
+        for (size_t i = 0; i < chunk; i++) {
+            encoder.writeBinary(task.data()[offset + i]);
+        }
+        int size = encoder.endBinaryWrite();
+        buffer[size++] = CFI_END_SYSEX;
+        _firmata->write(buffer, size);
+    }
+    return taskId;
+}
+
+// One message per run, the timing of the sequence is done by the board
+void CFI_SchedulerFeature::scheduleTask(byte taskId, unsigned long delay)
+{
+    byte buffer[10];
+    _firmata->write(buffer, encodeSchedulerMessage(SCHEDULE_FIRMATA_TASK, taskId, delay, buffer));
+}
+
+void CFI_SchedulerFeature::deleteTask(byte taskId)
+{
+    if (taskId >= 128) {
+        return;
+    }
+    byte buffer[5]{};
+
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_SCHEDULER_DATA;
+    buffer[2] = DELETE_FIRMATA_TASK;
+    buffer[3] = taskId;
+    buffer[4] = CFI_END_SYSEX;
+    _firmata->write(buffer, 5);
+    _usedTasks[taskId] = false;
+}
+
+void CFI_SchedulerFeature::reset()
+{
+    byte buffer[4]{};
+
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_SCHEDULER_DATA;
+    buffer[2] = RESET_FIRMATA_TASKS;
+    buffer[3] = CFI_END_SYSEX;
+    _firmata->write(buffer, 4);
+    for (byte i = 0; i < 128; i++) {
+        _usedTasks[i] = false;
+    }
+}
+
+// Count of tasks the board aborted, e.g. for lack of memory
+uint32_t CFI_SchedulerFeature::taskErrors()
+{
+    return _taskErrors;
+}
+
+void CFI_SchedulerFeature::setPinMode(byte pin, int mode)
+{
+    _firmata->setPinMode(pin, mode);
+}
+
+boolean CFI_SchedulerFeature::handleSysex(byte command, int argc, byte* argv)
+{
+    switch (command) {
+    case CFI_SCHEDULER_DATA:
+        if (argc < 1)
+        {
+            CFI_DEBUG_PRINTLN(F("Scheduler reply: Empty message error"));
+            return false;
+        }
+        if (argv[0] == ERROR_TASK_REPLY) {
+            CFI_DEBUG_PRINTLN(F("Scheduler reply: Task error"));
+            _taskErrors++;
+        }
+        return true;
+    }
+    return false;
+}
+
+void CFI_SchedulerFeature::updateFeature()
+{
+}
+
+boolean CFI_SchedulerFeature::handlesSysex(byte command)
+{
+    return command == CFI_SCHEDULER_DATA;
+}
+
+boolean CFI_SchedulerFeature::hasUpdate()
+{
+    return false;
+}
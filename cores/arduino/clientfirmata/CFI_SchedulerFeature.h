@@ -0,0 +1,89 @@
+/*
+  CFI_SchedulerFeature.h - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#ifndef CFI_SchedulerFeature_h
+#define CFI_SchedulerFeature_h
+
+#include "CFI_ClientFirmata.h"
+#include "CFI_ClientFirmataFeature.h"
+
+#define CREATE_FIRMATA_TASK             0
+#define DELETE_FIRMATA_TASK             1
+#define ADD_TO_FIRMATA_TASK             2
+#define DELAY_FIRMATA_TASK              3
+#define SCHEDULE_FIRMATA_TASK           4
+#define QUERY_ALL_FIRMATA_TASKS         5
+#define QUERY_FIRMATA_TASK              6
+#define RESET_FIRMATA_TASKS             7
+#define ERROR_TASK_REPLY                8
+#define QUERY_ALL_TASKS_REPLY           9
+#define QUERY_TASK_REPLY                10
+
+#define SCHEDULER_MAX_CHUNK 48 // task bytes per ADD_TO_FIRMATA_TASK, limited by the board's sysex buffer
+
+#if !defined(CFI_TASK_MAX_SIZE)
+#define CFI_TASK_MAX_SIZE 256 // bytes of Firmata messages in one recorded task
+#endif
+
+class CFI_ClientFirmata;
+
+// A sequence of pin operations with delays, recorded on the host as the
+// Firmata messages the board's scheduler executes.
+class CFI_SchedulerTask
+{
+public:
+    CFI_SchedulerTask();
+
+    void clear();
+    void pinMode(byte pin, byte mode);
+    void digitalWrite(byte pin, bool value);
+    void analogWrite(byte pin, int value);
+    void delay(unsigned long ms);
+    void schedule(byte taskId, unsigned long ms);
+
+    const byte* data() const { return _data; }
+    size_t size() const { return _size; }
+    bool overflow() const { return _overflow; }
+
+private:
+    void append(const byte* message, size_t size);
+
+    byte _data[CFI_TASK_MAX_SIZE];
+    size_t _size;
+    bool _overflow;
+};
+
+class CFI_SchedulerFeature : public CFI_ClientFirmataFeature
+{
+public:
+    CFI_SchedulerFeature(CFI_ClientFirmata& firmata);
+
+    int createTask(const CFI_SchedulerTask& task);
+    void scheduleTask(byte taskId, unsigned long delay);
+    void deleteTask(byte taskId);
+    void reset();
+    uint32_t taskErrors();
+
+    void setPinMode(byte pin, int mode);
+    boolean handleSysex(byte command, int argc, byte* argv);
+    void updateFeature();
+    boolean handlesSysex(byte command);
+    boolean hasUpdate();
+
+private:
+    CFI_ClientFirmata* _firmata;
+
+    bool _usedTasks[128] = { false };
+    uint32_t _taskErrors;
+};
+
+#endif
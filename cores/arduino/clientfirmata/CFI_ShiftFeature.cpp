@@ -0,0 +1,226 @@
+/*
+  CFI_ShiftFeature.cpp - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#include "CFI_ShiftFeature.h"
+
+CFI_ShiftFeature::CFI_ShiftFeature(CFI_ClientFirmata& firmata) : _firmata(&firmata), _capabilitiesKnown(false),
+    _isAwaitingReply(false), _inBuffer(NULL), _inCount(0)
+{
+    _firmata->addFeature(*this);
+}
+
+// The capabilities of the board are queried with the first shift,
+// without an answer the firmware is taken as not supporting shift mode.
+bool CFI_ShiftFeature::isSupported(byte dataPin, byte clockPin)
+{
+    if (!_capabilitiesKnown) {
+        queryCapabilities();
+    }
+    if (dataPin >= 128 || clockPin >= 128) {
+        return false;
+    }
+    return (_shiftPins[dataPin >> 3] & (1 << (dataPin & 0x07))) != 0 &&
+           (_shiftPins[clockPin >> 3] & (1 << (clockPin & 0x07))) != 0;
+}
+
+// One message per SHIFT_MAX_BYTES, the board clocks the bits
+void CFI_ShiftFeature::shiftOut(byte dataPin, byte clockPin, byte bitOrder, const byte* values, size_t count)
+{
+    preparePins(dataPin, clockPin);
+
+    byte buffer[SHIFT_MAX_BYTES * 2 + 6];
+    for (size_t offset = 0; offset < count; offset += SHIFT_MAX_BYTES) {
+        size_t chunk = count - offset;
+        if (chunk > SHIFT_MAX_BYTES) {
+            chunk = SHIFT_MAX_BYTES;
+        }
+        size_t size = 0;
+        buffer[size++] = CFI_START_SYSEX;
+        buffer[size++] = CFI_SHIFT_DATA;
+        buffer[size++] = SHIFT_OUT;
+        buffer[size++] = dataPin & 0x7F;
+        buffer[size++] = clockPin & 0x7F;
+        buffer[size++] = bitOrder & 0x01;
+        for (size_t i = 0; i < chunk; i++) {
+            buffer[size++] = values[offset + i] & 0x7F;
+            buffer[size++] = values[offset + i] >> 7;
+        }
+        buffer[size++] = CFI_END_SYSEX;
+        _firmata->write(buffer, size);
+    }
+}
+
+bool CFI_ShiftFeature::shiftIn(byte dataPin, byte clockPin, byte bitOrder, byte* values, size_t count)
+{
+    preparePins(dataPin, clockPin);
+
+    for (size_t offset = 0; offset < count; offset += SHIFT_MAX_BYTES) {
+        size_t chunk = count - offset;
+        if (chunk > SHIFT_MAX_BYTES) {
+            chunk = SHIFT_MAX_BYTES;
+        }
+        byte buffer[8]{};
+
+        buffer[0] = CFI_START_SYSEX;
+        buffer[1] = CFI_SHIFT_DATA;
+        buffer[2] = SHIFT_IN;
+        buffer[3] = dataPin & 0x7F;
+        buffer[4] = clockPin & 0x7F;
+        buffer[5] = bitOrder & 0x01;
+        buffer[6] = chunk & 0x7F;
+        buffer[7] = CFI_END_SYSEX;
+
+        _inBuffer = values + offset;
+        _inCount = chunk;
+        _isAwaitingReply = true;
+        _firmata->write(buffer, 8);
+
+        unsigned long startMicros = micros();
+        while (_isAwaitingReply) {
+            unsigned long elapsed = micros() - startMicros;
+            if (elapsed >= CFI_SHIFT_REPLY_TIMEOUT * 1000UL) {
+                break;
+            }
+            _firmata->update();
+            if (_isAwaitingReply) {
+                _firmata->waitForInput(CFI_SHIFT_REPLY_TIMEOUT * 1000UL - elapsed);
+            }
+        }
+        _inBuffer = NULL;
+        if (_isAwaitingReply) {
+            CFI_DEBUG_PRINTLN(F("Shift: Reply timed out"));
+            _isAwaitingReply = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+void CFI_ShiftFeature::queryCapabilities()
+{
+    _capabilitiesKnown = true;
+
+    byte buffer[3];
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_CAPABILITY_QUERY;
+    buffer[2] = CFI_END_SYSEX;
+    _isAwaitingReply = true;
+    _firmata->write(buffer, 3);
+
+    unsigned long startMicros = micros();
+    while (_isAwaitingReply) {
+        unsigned long elapsed = micros() - startMicros;
+        if (elapsed >= CFI_SHIFT_REPLY_TIMEOUT * 1000UL) {
+            break;
+        }
+        _firmata->update();
+        if (_isAwaitingReply) {
+            _firmata->waitForInput(CFI_SHIFT_REPLY_TIMEOUT * 1000UL - elapsed);
+        }
+    }
+    if (_isAwaitingReply) {
+        CFI_DEBUG_PRINTLN(F("Shift: No capability response"));
+        _isAwaitingReply = false;
+    }
+}
+
+void CFI_ShiftFeature::preparePins(byte dataPin, byte clockPin)
+{
+    byte pins[2] = { dataPin, clockPin };
+    for (byte i = 0; i < 2; i++) {
+        byte port = (pins[i] >> 3) & 0x0F;
+        byte bit = 1 << (pins[i] & 0x07);
+        if ((_modePins[port] & bit) == 0) {
+            _firmata->setPinMode(pins[i], CFI_PIN_MODE_SHIFT);
+            _modePins[port] |= bit;
+        }
+    }
+}
+
+void CFI_ShiftFeature::setPinMode(byte pin, int mode)
+{
+    _firmata->setPinMode(pin, mode);
+    if (mode != CFI_PIN_MODE_SHIFT && pin < 128) {
+        _modePins[pin >> 3] &= ~(1 << (pin & 0x07));
+    }
+}
+
+boolean CFI_ShiftFeature::handleSysex(byte command, int argc, byte* argv)
+{
+    switch (command) {
+    case CFI_CAPABILITY_RESPONSE:
+        handleCapabilityResponse(argc, argv);
+        // other features may evaluate the capabilities too
+        return false;
+    case CFI_SHIFT_DATA:
+        if (_inBuffer == NULL) {
+            // e.g. a reply of PingFirmata, which uses the same command byte
+            return false;
+        }
+        if (argc < 2 || argv[0] != SHIFT_IN_REPLY)
+        {
+            CFI_DEBUG_PRINTLN(F("Shift reply: Wrong message"));
+            return false;
+        }
+        handleShiftInReply(argc - 2, argv + 2);
+        return true;
+    }
+    return false;
+}
+
+// {mode, resolution}* 0x7F for each pin
+void CFI_ShiftFeature::handleCapabilityResponse(int argc, byte* argv)
+{
+    byte pin = 0;
+    for (int i = 0; i < argc && pin < 128; i++) {
+        if (argv[i] == 0x7F) {
+            pin++;
+            continue;
+        }
+        if (argv[i] == CFI_PIN_MODE_SHIFT) {
+            _shiftPins[pin >> 3] |= 1 << (pin & 0x07);
+        }
+        i++; // skip resolution
+    }
+    _isAwaitingReply = false;
+}
+
+void CFI_ShiftFeature::handleShiftInReply(byte argc, byte* argv)
+{
+    if (!_isAwaitingReply || _inBuffer == NULL) {
+        CFI_DEBUG_PRINTLN(F("Shift reply: Not awaiting reply"));
+        return;
+    }
+    _isAwaitingReply = false;
+
+    size_t count = argc / 2;
+    if (count > _inCount) {
+        count = _inCount;
+    }
+    for (size_t i = 0; i < count; i++) {
+        _inBuffer[i] = (argv[2 * i] & 0x7F) | (argv[2 * i + 1] << 7);
+    }
+}
+
+void CFI_ShiftFeature::updateFeature()
+{
+}
+
+boolean CFI_ShiftFeature::handlesSysex(byte command)
+{
+    return command == CFI_CAPABILITY_RESPONSE || command == CFI_SHIFT_DATA;
+}
+
+boolean CFI_ShiftFeature::hasUpdate()
+{
+    return false;
+}
@@ -0,0 +1,66 @@
+/*
+  CFI_ShiftFeature.h - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#ifndef CFI_ShiftFeature_h
+#define CFI_ShiftFeature_h
+
+#include "CFI_ClientFirmata.h"
+#include "CFI_ClientFirmataFeature.h"
+
+// Layout of the Firmata shift proposal:
+// SHIFT_OUT dataPin clockPin bitOrder {value bits 0-6, value bit 7}*
+// SHIFT_IN dataPin clockPin bitOrder numBytes
+// SHIFT_IN_REPLY dataPin {value bits 0-6, value bit 7}*
+#define SHIFT_OUT                       0x01
+#define SHIFT_IN                        0x02
+#define SHIFT_IN_REPLY                  0x03
+
+#define SHIFT_MAX_BYTES 24 // bytes per message, limited by the board's sysex buffer
+
+#if !defined(CFI_SHIFT_REPLY_TIMEOUT)
+#define CFI_SHIFT_REPLY_TIMEOUT 200 // ms to wait for the capabilities or shifted in data
+#endif
+
+class CFI_ClientFirmata;
+
+class CFI_ShiftFeature : public CFI_ClientFirmataFeature
+{
+public:
+    CFI_ShiftFeature(CFI_ClientFirmata& firmata);
+
+    bool isSupported(byte dataPin, byte clockPin);
+    void shiftOut(byte dataPin, byte clockPin, byte bitOrder, const byte* values, size_t count);
+    bool shiftIn(byte dataPin, byte clockPin, byte bitOrder, byte* values, size_t count);
+
+    void setPinMode(byte pin, int mode);
+    boolean handleSysex(byte command, int argc, byte* argv);
+    void updateFeature();
+    boolean handlesSysex(byte command);
+    boolean hasUpdate();
+
+private:
+    void queryCapabilities();
+    void preparePins(byte dataPin, byte clockPin);
+    void handleCapabilityResponse(int argc, byte* argv);
+    void handleShiftInReply(byte argc, byte* argv);
+
+    CFI_ClientFirmata* _firmata;
+
+    bool _capabilitiesKnown;
+    volatile bool _isAwaitingReply;
+    byte _shiftPins[16] = { 0 }; // bit mask of the pins supporting shift mode
+    byte _modePins[16] = { 0 }; // bit mask of the pins switched to shift mode
+    byte* _inBuffer;
+    size_t _inCount;
+};
+
+#endif
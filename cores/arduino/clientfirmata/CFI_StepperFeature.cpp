@@ -0,0 +1,272 @@
+/*
+  CFI_StepperFeature.cpp - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#include "CFI_StepperFeature.h"
+
+// 32 bit value in 5 bytes of 7 bits, LSB first, sign in bit 3 of the last byte
+static void encodeStepperLong(long value, byte* out)
+{
+    unsigned long magnitude = value < 0 ? -(unsigned long)value : value;
+    out[0] = magnitude & 0x7F;
+    out[1] = (magnitude >> 7) & 0x7F;
+    out[2] = (magnitude >> 14) & 0x7F;
+    out[3] = (magnitude >> 21) & 0x7F;
+    out[4] = ((magnitude >> 28) & 0x07) | (value < 0 ? 0x08 : 0x00);
+}
+
+static long decodeStepperLong(const byte* in)
+{
+    long value = (long)in[0] | (long)in[1] << 7 | (long)in[2] << 14 |
+                 (long)in[3] << 21 | (long)(in[4] & 0x07) << 28;
+    return (in[4] & 0x08) ? -value : value;
+}
+
+// AccelStepperFirmata float: 23 bit significand, 4 bit exponent to the
+// base 10 (bias 11) and a sign bit, packed into 4 bytes of 7 bits.
+static void encodeStepperFloat(float value, byte* out)
+{
+    const float maxSignificand = 8388608.0f; // 2^23
+    byte sign = value < 0 ? 1 : 0;
+    float significand = value < 0 ? -value : value;
+    int exponent = 0;
+
+    if (significand > 0) {
+        while (significand >= maxSignificand && exponent < 4) {
+            significand /= 10;
+            exponent++;
+        }
+        // shift as many decimals into the significand as fit
+        while (significand * 10 < maxSignificand && significand != (long)significand && exponent > -11) {
+            significand *= 10;
+            exponent--;
+        }
+    }
+    unsigned long bits = (unsigned long)significand;
+    exponent += 11;
+
+    out[0] = bits & 0x7F;
+    out[1] = (bits >> 7) & 0x7F;
+    out[2] = (bits >> 14) & 0x7F;
+    out[3] = ((bits >> 21) & 0x03) | (exponent & 0x0F) << 2 | sign << 6;
+}
+
+CFI_StepperFeature::CFI_StepperFeature(CFI_ClientFirmata& firmata) : _firmata(&firmata)
+{
+    _firmata->addFeature(*this);
+}
+
+// Pins holds two pins for drivers and two wire motors, otherwise three
+// or four. Returns the device number or -1 if all steppers are in use.
+int CFI_StepperFeature::config(byte interface, byte stepSize, const byte* pins, int enablePin, byte invertPins)
+{
+    byte deviceNum = 0;
+    while (deviceNum < CFI_MAX_STEPPERS && _configured[deviceNum]) {
+        deviceNum++;
+    }
+    if (deviceNum == CFI_MAX_STEPPERS) {
+        CFI_DEBUG_PRINTLN(F("Stepper: No free stepper"));
+        return -1;
+    }
+
+    byte data[7]{};
+    byte size = 0;
+    data[size++] = (interface & 0x07) << 4 | (stepSize & 0x07) << 1 | (enablePin >= 0 ? 1 : 0);
+    byte numPins = interface == ACCELSTEPPER_DRIVER ? 2 : interface;
+    for (byte i = 0; i < numPins; i++) {
+        data[size++] = pins[i] & 0x7F;
+    }
+    if (enablePin >= 0) {
+        data[size++] = enablePin & 0x7F;
+    }
+    data[size++] = invertPins & 0x1F;
+    sendCommand(ACCELSTEPPER_CONFIG, deviceNum, data, size);
+
+    _configured[deviceNum] = true;
+    _positions[deviceNum] = 0;
+    _running[deviceNum] = false;
+    return deviceNum;
+}
+
+void CFI_StepperFeature::zero(byte deviceNum)
+{
+    if (deviceNum >= CFI_MAX_STEPPERS) {
+        return;
+    }
+    sendCommand(ACCELSTEPPER_ZERO, deviceNum, NULL, 0);
+    _positions[deviceNum] = 0;
+}
+
+// Relative move, the board reports the completion
+void CFI_StepperFeature::step(byte deviceNum, long steps)
+{
+    if (deviceNum >= CFI_MAX_STEPPERS) {
+        return;
+    }
+    byte data[5];
+    encodeStepperLong(steps, data);
+    _running[deviceNum] = steps != 0;
+    sendCommand(ACCELSTEPPER_STEP, deviceNum, data, 5);
+}
+
+// Absolute move, the board reports the completion
+void CFI_StepperFeature::to(byte deviceNum, long position)
+{
+    if (deviceNum >= CFI_MAX_STEPPERS) {
+        return;
+    }
+    byte data[5];
+    encodeStepperLong(position, data);
+    _running[deviceNum] = true;
+    sendCommand(ACCELSTEPPER_TO, deviceNum, data, 5);
+}
+
+void CFI_StepperFeature::enable(byte deviceNum, bool enable)
+{
+    if (deviceNum >= CFI_MAX_STEPPERS) {
+        return;
+    }
+    byte data = enable ? 1 : 0;
+    sendCommand(ACCELSTEPPER_ENABLE, deviceNum, &data, 1);
+}
+
+// The board decelerates and reports the completion of the stop
+void CFI_StepperFeature::stop(byte deviceNum)
+{
+    if (deviceNum >= CFI_MAX_STEPPERS) {
+        return;
+    }
+    sendCommand(ACCELSTEPPER_STOP, deviceNum, NULL, 0);
+}
+
+void CFI_StepperFeature::setAcceleration(byte deviceNum, float acceleration)
+{
+    if (deviceNum >= CFI_MAX_STEPPERS) {
+        return;
+    }
+    byte data[4];
+    encodeStepperFloat(acceleration, data);
+    sendCommand(ACCELSTEPPER_SET_ACCELERATION, deviceNum, data, 4);
+}
+
+// Maximum speed in steps per second, or the constant speed without acceleration
+void CFI_StepperFeature::setSpeed(byte deviceNum, float speed)
+{
+    if (deviceNum >= CFI_MAX_STEPPERS) {
+        return;
+    }
+    byte data[4];
+    encodeStepperFloat(speed, data);
+    sendCommand(ACCELSTEPPER_SET_SPEED, deviceNum, data, 4);
+}
+
+// A round-trip while the motor moves, the reported position otherwise
+long CFI_StepperFeature::getPosition(byte deviceNum)
+{
+    if (deviceNum >= CFI_MAX_STEPPERS) {
+        return 0;
+    }
+    if (_running[deviceNum]) {
+        _isAwaitingReply[deviceNum] = true;
+        sendCommand(ACCELSTEPPER_REPORT_POSITION, deviceNum, NULL, 0);
+
+        unsigned long startMicros = micros();
+        while (_isAwaitingReply[deviceNum]) {
+            unsigned long elapsed = micros() - startMicros;
+            if (elapsed >= CFI_STEPPER_REPLY_TIMEOUT * 1000UL) {
+                break;
+            }
+            _firmata->update();
+            if (_isAwaitingReply[deviceNum]) {
+                _firmata->waitForInput(CFI_STEPPER_REPLY_TIMEOUT * 1000UL - elapsed);
+            }
+        }
+        if (_isAwaitingReply[deviceNum]) {
+            CFI_DEBUG_PRINTLN(F("Stepper: Position request timed out"));
+            _isAwaitingReply[deviceNum] = false;
+        }
+    }
+    return _positions[deviceNum];
+}
+
+bool CFI_StepperFeature::isRunning(byte deviceNum)
+{
+    return deviceNum < CFI_MAX_STEPPERS && _running[deviceNum];
+}
+
+void CFI_StepperFeature::sendCommand(byte command, byte deviceNum, const byte* data, byte size)
+{
+    byte buffer[16]{};
+
+    buffer[0] = CFI_START_SYSEX;
+    buffer[1] = CFI_ACCELSTEPPER_DATA;
+    buffer[2] = command;
+    buffer[3] = deviceNum & 0x7F;
+    for (byte i = 0; i < size; i++) {
+        buffer[4 + i] = data[i];
+    }
+    buffer[4 + size] = CFI_END_SYSEX;
+    _firmata->write(buffer, 5 + size);
+}
+
+void CFI_StepperFeature::setPinMode(byte pin, int mode)
+{
+    _firmata->setPinMode(pin, mode);
+}
+
+boolean CFI_StepperFeature::handleSysex(byte command, int argc, byte* argv)
+{
+    switch (command) {
+    case CFI_ACCELSTEPPER_DATA:
+        if (argc < 1)
+        {
+            CFI_DEBUG_PRINTLN(F("Stepper reply: Empty message error"));
+            return false;
+        }
+        handlePositionReply(argv[0], argc - 1, argv + 1);
+        return true;
+    }
+    return false;
+}
+
+// [device number] followed by the position in 5 bytes
+void CFI_StepperFeature::handlePositionReply(byte command, byte argc, byte* argv)
+{
+    if (command != ACCELSTEPPER_REPORT_POSITION && command != ACCELSTEPPER_MOVE_COMPLETE) {
+        CFI_DEBUG_PRINT(F("Stepper reply: Unknown command: "));
+        CFI_DEBUG_PRINTLN(command);
+        return;
+    }
+    if (argc < 6 || argv[0] >= CFI_MAX_STEPPERS) {
+        CFI_DEBUG_PRINTLN(F("Stepper reply: Wrong message"));
+        return;
+    }
+    byte deviceNum = argv[0];
+    _positions[deviceNum] = decodeStepperLong(argv + 1);
+    _isAwaitingReply[deviceNum] = false;
+    if (command == ACCELSTEPPER_MOVE_COMPLETE) {
+        _running[deviceNum] = false;
+    }
+}
+
+void CFI_StepperFeature::updateFeature()
+{
+}
+
+boolean CFI_StepperFeature::handlesSysex(byte command)
+{
+    return command == CFI_ACCELSTEPPER_DATA;
+}
+
+boolean CFI_StepperFeature::hasUpdate()
+{
+    return false;
+}
@@ -0,0 +1,82 @@
+/*
+  CFI_StepperFeature.h - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#ifndef CFI_StepperFeature_h
+#define CFI_StepperFeature_h
+
+#include "CFI_ClientFirmata.h"
+#include "CFI_ClientFirmataFeature.h"
+
+#define ACCELSTEPPER_CONFIG             0x00
+#define ACCELSTEPPER_ZERO               0x01
+#define ACCELSTEPPER_STEP               0x02
+#define ACCELSTEPPER_TO                 0x03
+#define ACCELSTEPPER_ENABLE             0x04
+#define ACCELSTEPPER_STOP               0x05
+#define ACCELSTEPPER_REPORT_POSITION    0x06
+#define ACCELSTEPPER_SET_ACCELERATION   0x08
+#define ACCELSTEPPER_SET_SPEED          0x09
+#define ACCELSTEPPER_MOVE_COMPLETE      0x0A
+
+// interface types
+#define ACCELSTEPPER_DRIVER             1 // step and direction pins
+#define ACCELSTEPPER_TWO_WIRE           2
+#define ACCELSTEPPER_THREE_WIRE         3
+#define ACCELSTEPPER_FOUR_WIRE          4
+
+// step sizes
+#define ACCELSTEPPER_STEP_WHOLE         0
+#define ACCELSTEPPER_STEP_HALF          1
+
+#define CFI_MAX_STEPPERS 10 // same limit as AccelStepperFirmata on the board
+
+#if !defined(CFI_STEPPER_REPLY_TIMEOUT)
+#define CFI_STEPPER_REPLY_TIMEOUT 100 // ms to wait for a requested position
+#endif
+
+class CFI_ClientFirmata;
+
+class CFI_StepperFeature : public CFI_ClientFirmataFeature
+{
+public:
+    CFI_StepperFeature(CFI_ClientFirmata& firmata);
+
+    int config(byte interface, byte stepSize, const byte* pins, int enablePin, byte invertPins);
+    void zero(byte deviceNum);
+    void step(byte deviceNum, long steps);
+    void to(byte deviceNum, long position);
+    void enable(byte deviceNum, bool enable);
+    void stop(byte deviceNum);
+    void setAcceleration(byte deviceNum, float acceleration);
+    void setSpeed(byte deviceNum, float speed);
+    long getPosition(byte deviceNum);
+    bool isRunning(byte deviceNum);
+
+    void setPinMode(byte pin, int mode);
+    boolean handleSysex(byte command, int argc, byte* argv);
+    void updateFeature();
+    boolean handlesSysex(byte command);
+    boolean hasUpdate();
+
+private:
+    void sendCommand(byte command, byte deviceNum, const byte* data, byte size);
+    void handlePositionReply(byte command, byte argc, byte* argv);
+
+    CFI_ClientFirmata* _firmata;
+
+    bool _configured[CFI_MAX_STEPPERS] = { false };
+    volatile long _positions[CFI_MAX_STEPPERS] = { 0 }; // last position reported by the board
+    volatile bool _running[CFI_MAX_STEPPERS] = { false }; // move sent, no completion reported yet
+    volatile bool _isAwaitingReply[CFI_MAX_STEPPERS] = { false };
+};
+
+#endif
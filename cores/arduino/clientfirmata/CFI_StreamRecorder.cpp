@@ -0,0 +1,317 @@
+/*
+  CFI_StreamRecorder.cpp - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#include "CFI_StreamRecorder.h"
+
+static const byte recordHeader[5] = { 'C', 'F', 'I', 'R', 1 };
+
+//******************************************************************************
+//* CFI_StreamRecorder
+//******************************************************************************
+
+CFI_StreamRecorder::CFI_StreamRecorder() : _stream(NULL), _file(NULL), _lastMicros(0),
+    _direction(CFI_RECORD_INBOUND), _size(0), _micros(0)
+{
+}
+
+CFI_StreamRecorder::~CFI_StreamRecorder()
+{
+    end();
+}
+
+bool CFI_StreamRecorder::begin(Stream& stream, const char* fileName)
+{
+    end();
+    _stream = &stream;
+    _file = fopen(fileName, "wb");
+    if (_file == NULL) {
+        logError("Can't open record file %s\n", fileName);
+        return false;
+    }
+    fwrite(recordHeader, 1, sizeof(recordHeader), _file);
+    _lastMicros = micros();
+    _size = 0;
+    return true;
+}
+
+void CFI_StreamRecorder::end()
+{
+    if (_file != NULL) {
+        writeRecord();
+        fclose(_file);
+        _file = NULL;
+    }
+}
+
+void CFI_StreamRecorder::record(byte direction, const byte* data, size_t size)
+{
+    if (_file == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < size; i++) {
+        if (_size == CFI_RECORD_MAX_DATA || (_size > 0 && direction != _direction)) {
+            writeRecord();
+        }
+        if (_size == 0) {
+            _direction = direction;
+            _micros = micros();
+        }
+        _data[_size++] = data[i];
+    }
+}
+
+void CFI_StreamRecorder::writeRecord()
+{
+    if (_size == 0) {
+        return;
+    }
+    byte header[6];
+    size_t length = 0;
+    unsigned long delta = _micros - _lastMicros;
+    header[length++] = _direction | (byte)(_size - 1);
+    do {
+        header[length] = delta & 0x7F;
+        delta >>= 7;
+        if (delta != 0) {
+            header[length] |= 0x80;
+        }
+        length++;
+    } while (delta != 0);
+    fwrite(header, 1, length, _file);
+    fwrite(_data, 1, _size, _file);
+
+    _lastMicros = _micros;
+    _size = 0;
+}
+
+int CFI_StreamRecorder::available()
+{
+    int bytes = _stream->available();
+    // the bytes received at once form one inbound record
+    if (bytes == 0 && _size > 0 && _direction == CFI_RECORD_INBOUND) {
+        writeRecord();
+    }
+    return bytes;
+}
+
+bool CFI_StreamRecorder::waitAvailable(unsigned long timeout)
+{
+    return _stream->waitAvailable(timeout);
+}
+
+int CFI_StreamRecorder::read()
+{
+    int value = _stream->read();
+    if (value != -1) {
+        byte data = (byte)value;
+        record(CFI_RECORD_INBOUND, &data, 1);
+    }
+    return value;
+}
+
+int CFI_StreamRecorder::peek()
+{
+    return _stream->peek();
+}
+
+void CFI_StreamRecorder::flush()
+{
+    _stream->flush();
+}
+
+size_t CFI_StreamRecorder::write(uint8_t b)
+{
+    return write(&b, 1);
+}
+
+size_t CFI_StreamRecorder::write(const uint8_t* buffer, size_t size)
+{
+    size_t bytes = _stream->write(buffer, size);
+    record(CFI_RECORD_OUTBOUND, buffer, bytes);
+    return bytes;
+}
+
+//******************************************************************************
+//* CFI_StreamReplayer
+//******************************************************************************
+
+CFI_StreamReplayer::CFI_StreamReplayer() : _file(NULL), _recordedTiming(false), _startMicros(0), _mismatches(0),
+    _size(0), _position(0), _recordMicros(0), _direction(CFI_RECORD_INBOUND), _expectedHead(0), _expectedCount(0), _waitStart(0)
+{
+}
+
+CFI_StreamReplayer::~CFI_StreamReplayer()
+{
+    end();
+}
+
+bool CFI_StreamReplayer::begin(const char* fileName, bool recordedTiming)
+{
+    end();
+    _file = fopen(fileName, "rb");
+    if (_file == NULL) {
+        logError("Can't open record file %s\n", fileName);
+        return false;
+    }
+    byte header[sizeof(recordHeader)];
+    if (fread(header, 1, sizeof(header), _file) != sizeof(header) ||
+        memcmp(header, recordHeader, sizeof(header)) != 0) {
+        logError("%s is no record file\n", fileName);
+        end();
+        return false;
+    }
+    _recordedTiming = recordedTiming;
+    _startMicros = micros();
+    _mismatches = 0;
+    _recordMicros = 0;
+    _size = _position = 0;
+    _expectedHead = _expectedCount = 0;
+    return true;
+}
+
+void CFI_StreamReplayer::end()
+{
+    if (_file != NULL) {
+        fclose(_file);
+        _file = NULL;
+    }
+}
+
+// All inbound bytes are read
+bool CFI_StreamReplayer::finished()
+{
+    return _position == _size && !nextInbound();
+}
+
+// Reads the next record of the log, false at its end
+bool CFI_StreamReplayer::nextRecord()
+{
+    if (_file == NULL) {
+        return false;
+    }
+    int tag = fgetc(_file);
+    if (tag == EOF) {
+        end();
+        return false;
+    }
+    unsigned long delta = 0;
+    int shift = 0;
+    int value;
+    do {
+        value = fgetc(_file);
+        if (value == EOF) {
+            end();
+            return false;
+        }
+        delta |= (unsigned long)(value & 0x7F) << shift;
+        shift += 7;
+    } while (value & 0x80);
+
+    _direction = tag & CFI_RECORD_OUTBOUND;
+    _size = (tag & 0x7F) + 1;
+    _position = 0;
+    _recordMicros += delta;
+    if (fread(_data, 1, _size, _file) != _size) {
+        end();
+        _size = 0;
+        return false;
+    }
+    return true;
+}
+
+// Loads the next inbound record, the outbound records before it are queued
+// for the comparison with the written bytes
+bool CFI_StreamReplayer::nextInbound()
+{
+    while (nextRecord()) {
+        if (_direction == CFI_RECORD_INBOUND) {
+            _waitStart = millis();
+            return true;
+        }
+        for (size_t i = 0; i < _size; i++) {
+            if (_expectedCount == CFI_REPLAY_EXPECTED_SIZE) {
+                // the client does not write at all, drop the oldest
+                _expectedHead = (_expectedHead + 1) % CFI_REPLAY_EXPECTED_SIZE;
+                _expectedCount--;
+                _mismatches++;
+            }
+            _expected[(_expectedHead + _expectedCount++) % CFI_REPLAY_EXPECTED_SIZE] = _data[i];
+        }
+        _size = _position = 0;
+    }
+    return false;
+}
+
+int CFI_StreamReplayer::available()
+{
+    if (_position == _size && !nextInbound()) {
+        return 0;
+    }
+    if (_recordedTiming) {
+        if ((long)(micros() - _startMicros - _recordMicros) < 0) {
+            return 0;
+        }
+    } else if (_expectedCount > 0) {
+        // a reply is released only after the client has sent its request
+        if (_position == 0 && millis() - _waitStart < CFI_REPLAY_WAIT_TIMEOUT) {
+            return 0;
+        }
+        _mismatches += _expectedCount;
+        _expectedCount = 0;
+    }
+    return (int)(_size - _position);
+}
+
+int CFI_StreamReplayer::read()
+{
+    if (available() == 0) {
+        return -1;
+    }
+    return _data[_position++];
+}
+
+int CFI_StreamReplayer::peek()
+{
+    if (available() == 0) {
+        return -1;
+    }
+    return _data[_position];
+}
+
+void CFI_StreamReplayer::flush()
+{
+}
+
+size_t CFI_StreamReplayer::write(uint8_t b)
+{
+    return write(&b, 1);
+}
+
+size_t CFI_StreamReplayer::write(const uint8_t* buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (_expectedCount == 0 && _position == _size) {
+            // the recorded request is still in front of the next reply
+            nextInbound();
+        }
+        if (_expectedCount == 0) {
+            _mismatches++;
+            continue;
+        }
+        if (_expected[_expectedHead] != buffer[i]) {
+            _mismatches++;
+        }
+        _expectedHead = (_expectedHead + 1) % CFI_REPLAY_EXPECTED_SIZE;
+        _expectedCount--;
+    }
+    return size;
+}
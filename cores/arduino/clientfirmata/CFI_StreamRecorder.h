@@ -0,0 +1,116 @@
+/*
+  CFI_StreamRecorder.h - ClientFirmata library
+  Copyright (C) 2022 Immo Wache.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  See file LICENSE.txt for further informations on licensing terms.
+*/
+
+#ifndef CFI_StreamRecorder_h
+#define CFI_StreamRecorder_h
+
+#include <stdio.h>
+#include "Stream.h"
+
+// Log file: header 'C', 'F', 'I', 'R', version 1, then records of
+// tag (bit 7 set = written by the host, bits 0..6 = data size - 1),
+// microseconds since the previous record (LEB128 varint) and the data bytes.
+#define CFI_RECORD_INBOUND   0x00
+#define CFI_RECORD_OUTBOUND  0x80
+#define CFI_RECORD_MAX_DATA  128
+
+#if !defined(CFI_REPLAY_EXPECTED_SIZE)
+#define CFI_REPLAY_EXPECTED_SIZE 1024 // recorded host bytes waiting for the comparison with the replayed ones
+#endif
+
+#if !defined(CFI_REPLAY_WAIT_TIMEOUT)
+#define CFI_REPLAY_WAIT_TIMEOUT 100 // ms a reply waits for the recorded request before it is released anyway
+#endif
+
+// Tap between CFI_ClientFirmata and its stream, logs every byte of both
+// directions with a microsecond timestamp.
+class CFI_StreamRecorder : public Stream
+{
+public:
+    CFI_StreamRecorder();
+    ~CFI_StreamRecorder();
+
+    bool begin(Stream& stream, const char* fileName);
+    void end();
+
+    int available();
+    bool waitAvailable(unsigned long timeout);
+    int read();
+    int peek();
+    void flush();
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buffer, size_t size);
+
+    using Print::write; // pull in write(str) and write(buf, size) from Print
+
+private:
+    void record(byte direction, const byte* data, size_t size);
+    void writeRecord();
+
+    Stream* _stream;
+    FILE* _file;
+    unsigned long _lastMicros;
+
+    /* the record is extended while the direction does not change */
+    byte _direction;
+    byte _data[CFI_RECORD_MAX_DATA];
+    size_t _size;
+    unsigned long _micros;
+};
+
+// Stream which plays back the inbound side of a recorded log, either at the
+// recorded timing or as fast as the client reads. The bytes written by the
+// client are compared with the recorded ones.
+class CFI_StreamReplayer : public Stream
+{
+public:
+    CFI_StreamReplayer();
+    ~CFI_StreamReplayer();
+
+    bool begin(const char* fileName, bool recordedTiming);
+    void end();
+    bool finished();
+    unsigned long mismatches() { return _mismatches; }
+
+    int available();
+    int read();
+    int peek();
+    void flush();
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buffer, size_t size);
+
+    using Print::write; // pull in write(str) and write(buf, size) from Print
+
+private:
+    bool nextRecord();
+    bool nextInbound();
+
+    FILE* _file;
+    bool _recordedTiming;
+    unsigned long _startMicros;
+    unsigned long _mismatches;
+
+    /* current inbound record */
+    byte _data[CFI_RECORD_MAX_DATA];
+    size_t _size;
+    size_t _position;
+    unsigned long _recordMicros; // since the start of the log
+    byte _direction;
+
+    /* recorded host bytes not yet compared */
+    byte _expected[CFI_REPLAY_EXPECTED_SIZE];
+    size_t _expectedHead;
+    size_t _expectedCount;
+    unsigned long _waitStart; // millis when the current inbound record was loaded
+};
+
+#endif
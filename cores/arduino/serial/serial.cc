@@ -5,8 +5,13 @@
   Copyright (c) 2022 Immo Wache <virtual.mkr@gmail.com>
 */
 
+#include <thread>
 #include "serial.h"
+#if defined(_WIN32)
 #include "win.h"
+#else
+#include "unix.h"
+#endif
 
 using std::invalid_argument;
 using std::min;
@@ -23,9 +28,11 @@ using serial::parity_t;
 using serial::stopbits_t;
 using serial::flowcontrol_t;
 
+#if SERIAL_LOCK_POLICY == SERIAL_LOCK_MUTEX
+
 class SerialClass::ScopedReadLock {
 public:
-  ScopedReadLock(SerialImpl *pimpl) : pimpl_(pimpl) {
+  ScopedReadLock(SerialClass *serial) : pimpl_(serial->pimpl_) {
     this->pimpl_->readLock();
   }
   ~ScopedReadLock() {
@@ -41,7 +48,7 @@ private:
 
 class SerialClass::ScopedWriteLock {
 public:
-  ScopedWriteLock(SerialImpl *pimpl) : pimpl_(pimpl) {
+  ScopedWriteLock(SerialClass *serial) : pimpl_(serial->pimpl_) {
     this->pimpl_->writeLock();
   }
   ~ScopedWriteLock() {
@@ -54,6 +61,56 @@ private:
   SerialImpl *pimpl_;
 };
 
+#elif SERIAL_LOCK_POLICY == SERIAL_LOCK_SPIN
+
+class SerialClass::ScopedReadLock {
+public:
+  ScopedReadLock(SerialClass *serial) : flag_(serial->read_lock_) {
+    while (flag_.test_and_set(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+  ~ScopedReadLock() {
+    flag_.clear(std::memory_order_release);
+  }
+private:
+  // Disable copy constructors
+  ScopedReadLock(const ScopedReadLock&);
+
+  std::atomic_flag &flag_;
+};
+
+class SerialClass::ScopedWriteLock {
+public:
+  ScopedWriteLock(SerialClass *serial) : flag_(serial->write_lock_) {
+    while (flag_.test_and_set(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+  ~ScopedWriteLock() {
+    flag_.clear(std::memory_order_release);
+  }
+private:
+  // Disable copy constructors
+  ScopedWriteLock(const ScopedWriteLock&);
+
+  std::atomic_flag &flag_;
+};
+
+#else // SERIAL_LOCK_NONE
+
+class SerialClass::ScopedReadLock {
+public:
+  ScopedReadLock(SerialClass *) {}
+};
+
+class SerialClass::ScopedWriteLock {
+public:
+  ScopedWriteLock(SerialClass *) {}
+};
+
+#endif
+
 SerialClass::SerialClass (const string &port, uint32_t baudrate, serial::Timeout timeout,
                 bytesize_t bytesize, parity_t parity, stopbits_t stopbits,
                 flowcontrol_t flowcontrol)
@@ -99,6 +156,12 @@ SerialClass::waitReadable ()
   return pimpl_->waitReadable(timeout.read_timeout_constant);
 }
 
+bool
+SerialClass::waitReadable (uint32_t timeout)
+{
+  return pimpl_->waitReadable(timeout);
+}
+
 void
 SerialClass::waitByteTimes (size_t count)
 {
@@ -114,47 +177,48 @@ SerialClass::read_ (uint8_t *buffer, size_t size)
 size_t
 SerialClass::read (uint8_t *buffer, size_t size)
 {
-  ScopedReadLock lock(this->pimpl_);
+  ScopedReadLock lock(this);
   return this->pimpl_->read (buffer, size);
 }
 
 size_t
 SerialClass::read (std::vector<uint8_t> &buffer, size_t size)
 {
-  ScopedReadLock lock(this->pimpl_);
-  uint8_t *buffer_ = new uint8_t[size];
+  ScopedReadLock lock(this);
+  // read directly behind the bytes the caller already has
+  size_t offset = buffer.size ();
+  buffer.resize (offset + size);
   size_t bytes_read = 0;
 
   try {
-    bytes_read = this->pimpl_->read (buffer_, size);
+    bytes_read = this->pimpl_->read (buffer.data () + offset, size);
   }
   catch (const std::exception &e) {
     (void)e;
-    delete[] buffer_;
+    buffer.resize (offset);
     throw;
   }
 
-  buffer.insert (buffer.end (), buffer_, buffer_+bytes_read);
-  delete[] buffer_;
+  buffer.resize (offset + bytes_read);
   return bytes_read;
 }
 
 size_t
 SerialClass::read (std::string &buffer, size_t size)
 {
-  ScopedReadLock lock(this->pimpl_);
-  uint8_t *buffer_ = new uint8_t[size];
+  ScopedReadLock lock(this);
+  size_t offset = buffer.size ();
+  buffer.resize (offset + size);
   size_t bytes_read = 0;
   try {
-    bytes_read = this->pimpl_->read (buffer_, size);
+    bytes_read = this->pimpl_->read (reinterpret_cast<uint8_t*>(&buffer[offset]), size);
   }
   catch (const std::exception &e) {
     (void)e;
-    delete[] buffer_;
+    buffer.resize (offset);
     throw;
   }
-  buffer.append (reinterpret_cast<const char*>(buffer_), bytes_read);
-  delete[] buffer_;
+  buffer.resize (offset + bytes_read);
   return bytes_read;
 }
 
@@ -169,7 +233,7 @@ SerialClass::read (size_t size)
 size_t
 SerialClass::write (const string &data)
 {
-  ScopedWriteLock lock(this->pimpl_);
+  ScopedWriteLock lock(this);
   return this->write_ (reinterpret_cast<const uint8_t*>(data.c_str()),
                        data.length());
 }
@@ -177,14 +241,14 @@ SerialClass::write (const string &data)
 size_t
 SerialClass::write (const std::vector<uint8_t> &data)
 {
-  ScopedWriteLock lock(this->pimpl_);
+  ScopedWriteLock lock(this);
   return this->write_ (&data[0], data.size());
 }
 
 size_t
 SerialClass::write (const uint8_t *data, size_t size)
 {
-  ScopedWriteLock lock(this->pimpl_);
+  ScopedWriteLock lock(this);
   return this->write_(data, size);
 }
 
@@ -197,8 +261,8 @@ SerialClass::write_ (const uint8_t *data, size_t length)
 void
 SerialClass::setPort (const string &port)
 {
-  ScopedReadLock rlock(this->pimpl_);
-  ScopedWriteLock wlock(this->pimpl_);
+  ScopedReadLock rlock(this);
+  ScopedWriteLock wlock(this);
   bool was_open = pimpl_->isOpen ();
   if (was_open) close();
   pimpl_->setPort (port);
@@ -284,20 +348,20 @@ SerialClass::getFlowcontrol () const
 
 void SerialClass::flush ()
 {
-  ScopedReadLock rlock(this->pimpl_);
-  ScopedWriteLock wlock(this->pimpl_);
+  ScopedReadLock rlock(this);
+  ScopedWriteLock wlock(this);
   pimpl_->flush ();
 }
 
 void SerialClass::flushInput ()
 {
-  ScopedReadLock lock(this->pimpl_);
+  ScopedReadLock lock(this);
   pimpl_->flushInput ();
 }
 
 void SerialClass::flushOutput ()
 {
-  ScopedWriteLock lock(this->pimpl_);
+  ScopedWriteLock lock(this);
   pimpl_->flushOutput ();
 }
 
@@ -45,7 +45,22 @@
 #include <sstream>
 #include <exception>
 #include <stdexcept>
+#include <limits>
+#include <cstring>
 #include <stdint.h>
+#include <atomic>
+
+/*
+ * Locking of SerialClass reads and writes, SERIAL_LOCK_MUTEX is needed only
+ * when several threads read (or write) the same port concurrently.
+ */
+#define SERIAL_LOCK_NONE  0 // no locking at all
+#define SERIAL_LOCK_SPIN  1 // user space spin lock, no system call while uncontended
+#define SERIAL_LOCK_MUTEX 2 // the mutexes of the operating system
+
+#if !defined(SERIAL_LOCK_POLICY)
+#define SERIAL_LOCK_POLICY SERIAL_LOCK_SPIN
+#endif
 
 #define THROW(exceptionClass, message) throw exceptionClass(__FILE__, \
 __LINE__, (message) )
@@ -228,6 +243,11 @@ public:
   bool
   waitReadable ();
 
+  /*! Block until there is serial data to read or timeout milliseconds
+   * have elapsed. */
+  bool
+  waitReadable (uint32_t timeout);
+
   /*! Block for a period of time corresponding to the transmission time of
    * count characters at present serial settings. This may be used in con-
    * junction with waitReadable to read larger blocks of data from the
@@ -614,6 +634,11 @@ private:
   class ScopedReadLock;
   class ScopedWriteLock;
 
+#if SERIAL_LOCK_POLICY == SERIAL_LOCK_SPIN
+  std::atomic_flag read_lock_ = ATOMIC_FLAG_INIT;
+  std::atomic_flag write_lock_ = ATOMIC_FLAG_INIT;
+#endif
+
   // Read common function
   size_t
   read_ (uint8_t *buffer, size_t size);
@@ -0,0 +1,103 @@
+/*
+  unix_serial_tests.cc - Part of the VirtualBoard project
+
+  Checks the POSIX backend of the serial library against a pseudo
+  terminal pair, no device needed. Build and run on Linux or macOS:
+
+    g++ -std=c++17 -Wall -I.. unix_serial_tests.cc -o unix_serial_tests -lutil -pthread
+    ./unix_serial_tests
+
+  Copyright (c) 2022 Immo Wache <virtual.mkr@gmail.com>
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+*/
+
+#include "serial.cc"
+#include "unix.cc"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#if defined(__APPLE__)
+# include <util.h>
+#else
+# include <pty.h>
+#endif
+
+using serial::SerialClass;
+using serial::Timeout;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      failures++; \
+    } \
+  } while (0)
+
+static unsigned long elapsedMillis(std::chrono::steady_clock::time_point start)
+{
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+  int master, slave;
+  char name[64];
+  if (openpty(&master, &slave, name, NULL, NULL) != 0) {
+    printf("openpty failed\n");
+    return 1;
+  }
+
+  // a non standard rate needs the termios2 / IOSSIOSPEED path
+  SerialClass port(name, 250000, Timeout::simpleTimeout(200));
+  CHECK(port.isOpen());
+  CHECK(port.getBaudrate() == 250000);
+
+  // nothing to read: waitReadable() times out, read() returns after the timeout
+  CHECK(!port.waitReadable(50));
+  CHECK(port.available() == 0);
+  uint8_t buffer[16];
+  auto start = std::chrono::steady_clock::now();
+  CHECK(port.read(buffer, 3) == 0);
+  unsigned long waited = elapsedMillis(start);
+  CHECK(waited >= 150 && waited < 1000);
+
+  // master to port
+  CHECK(::write(master, "hello", 5) == 5);
+  CHECK(port.waitReadable(500));
+  usleep(10000);
+  CHECK(port.available() == 5);
+  CHECK(port.read(buffer, 5) == 5);
+  CHECK(memcmp(buffer, "hello", 5) == 0);
+
+  // vector read
+  CHECK(::write(master, "abc", 3) == 3);
+  std::vector<uint8_t> data;
+  CHECK(port.read(data, 3) == 3);
+  CHECK(data.size() == 3 && data[0] == 'a' && data[2] == 'c');
+
+  // port to master
+  CHECK(port.write((const uint8_t *)"xyz", 3) == 3);
+  port.flush();
+  char received[8];
+  CHECK(::read(master, received, sizeof(received)) == 3);
+  CHECK(memcmp(received, "xyz", 3) == 0);
+
+  port.setBaudrate(115200);
+  CHECK(port.getBaudrate() == 115200);
+
+  port.close();
+  CHECK(!port.isOpen());
+  ::close(slave);
+  ::close(master);
+
+  printf("%s\n", failures == 0 ? "all checks passed" : "FAILED");
+  return failures == 0 ? 0 : 1;
+}
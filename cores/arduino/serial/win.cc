@@ -71,6 +71,8 @@ SerialClass::SerialImpl::open ()
   // See: https://github.com/wjwwood/serial/issues/84
   wstring port_with_prefix = _prefix_port_if_needed(port_);
   LPCWSTR lp_port = port_with_prefix.c_str();
+  // Not opened with FILE_FLAG_OVERLAPPED: reads, writes and ClearCommError()
+  // on the handle wait for each other, even from different threads.
   fd_ = CreateFileW(lp_port,
                     GENERIC_READ | GENERIC_WRITE,
                     0,
@@ -321,10 +323,18 @@ SerialClass::SerialImpl::available ()
 }
 
 bool
-SerialClass::SerialImpl::waitReadable (uint32_t /*timeout*/)
-{
-  THROW (IOException, "waitReadable is not implemented on Windows.");
-  return false;
+SerialClass::SerialImpl::waitReadable (uint32_t timeout)
+{
+  // The port is not opened for overlapped I/O, so WaitCommEvent() could
+  // not time out; sleep in steps of the system timer instead of spinning.
+  DWORD start = GetTickCount();
+  while (available() == 0) {
+    if (GetTickCount() - start >= timeout) {
+      return false;
+    }
+    Sleep(1);
+  }
+  return true;
 }
 
 void
@@ -0,0 +1,302 @@
+/*
+  AccelStepper.cpp - Part of the VirtualBoard project
+
+  Stepper motor API compatible with the AccelStepper library by Mike McCauley.
+
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AccelStepper.h"
+#include <utils/log.h>
+
+#if defined(VB_FIRMATA_PORT)
+// One feature serves all steppers
+static CFI_StepperFeature* stepperFeature()
+{
+  static CFI_StepperFeature* feature = new CFI_StepperFeature(GPIO.ClientFirmata);
+  return feature;
+}
+#endif
+
+AccelStepper::AccelStepper(uint8_t interface, uint8_t pin1, uint8_t pin2, uint8_t pin3, uint8_t pin4, bool enable)
+{
+  _interface = interface;
+  _pins[0] = pin1;
+  _pins[1] = pin2;
+  _pins[2] = pin3;
+  _pins[3] = pin4;
+  _enabled = enable;
+}
+
+bool AccelStepper::configure()
+{
+#if defined(VB_FIRMATA_PORT)
+  if (!_configured) {
+    _configured = true;
+    byte type = _interface;
+    byte stepSize = ACCELSTEPPER_STEP_WHOLE;
+    if (_interface == HALF3WIRE || _interface == HALF4WIRE) {
+      type = _interface / 2;
+      stepSize = ACCELSTEPPER_STEP_HALF;
+    }
+    if (type < ACCELSTEPPER_DRIVER || type > ACCELSTEPPER_FOUR_WIRE) {
+      logError("AccelStepper: Motor interface %d not supported\n", _interface);
+      return false;
+    }
+    int enablePin = _enablePin == 0xff ? -1 : _enablePin;
+    _deviceNum = stepperFeature()->config(type, stepSize, _pins, enablePin, _invertPins);
+    if (_deviceNum < 0) {
+      logError("AccelStepper: No free stepper on the board\n");
+      return false;
+    }
+    stepperFeature()->setSpeed(_deviceNum, _maxSpeed);
+    stepperFeature()->setAcceleration(_deviceNum, _acceleration);
+    stepperFeature()->enable(_deviceNum, _enabled);
+  }
+  return _deviceNum >= 0;
+#else
+  return false;
+#endif
+}
+
+void AccelStepper::moveTo(long absolute)
+{
+  if (absolute == _targetPos && !_runningSpeed && isRunning()) {
+    // sketches often repeat the target in every loop
+    return;
+  }
+  _targetPos = absolute;
+#if defined(VB_FIRMATA_PORT)
+  if (configure()) {
+    if (_runningSpeed) {
+      // runSpeed() replaced the board's maximum speed with its constant speed
+      stepperFeature()->setSpeed(_deviceNum, _maxSpeed);
+    }
+    stepperFeature()->to(_deviceNum, absolute - _offset);
+  }
+#else
+  _currentPos = absolute;
+#endif
+  _runningSpeed = false;
+}
+
+void AccelStepper::move(long relative)
+{
+  moveTo(currentPosition() + relative);
+}
+
+bool AccelStepper::run()
+{
+  yield();
+  return isRunning();
+}
+
+// Constant speed is approximated by a long move at the speed
+// with the configured acceleration.
+bool AccelStepper::runSpeed()
+{
+#if defined(VB_FIRMATA_PORT)
+  if (_speed != 0 && !_runningSpeed && configure()) {
+    _runningSpeed = true;
+    stepperFeature()->setSpeed(_deviceNum, _speed < 0 ? -_speed : _speed);
+    stepperFeature()->step(_deviceNum, _speed < 0 ? -0x7FFFFFF : 0x7FFFFFF);
+  }
+#endif
+  return run();
+}
+
+void AccelStepper::setMaxSpeed(float speed)
+{
+  if (speed < 0.0) {
+    speed = -speed;
+  }
+  if (speed == _maxSpeed) {
+    return;
+  }
+  _maxSpeed = speed;
+#if defined(VB_FIRMATA_PORT)
+  if (_configured && _deviceNum >= 0) {
+    stepperFeature()->setSpeed(_deviceNum, speed);
+  }
+#endif
+}
+
+float AccelStepper::maxSpeed()
+{
+  return _maxSpeed;
+}
+
+void AccelStepper::setAcceleration(float acceleration)
+{
+  if (acceleration == 0.0) {
+    return;
+  }
+  if (acceleration < 0.0) {
+    acceleration = -acceleration;
+  }
+  if (acceleration == _acceleration) {
+    return;
+  }
+  _acceleration = acceleration;
+#if defined(VB_FIRMATA_PORT)
+  if (_configured && _deviceNum >= 0) {
+    stepperFeature()->setAcceleration(_deviceNum, acceleration);
+  }
+#endif
+}
+
+float AccelStepper::acceleration()
+{
+  return _acceleration;
+}
+
+void AccelStepper::setSpeed(float speed)
+{
+  if (speed == _speed) {
+    return;
+  }
+  _speed = speed;
+  if (_runningSpeed) {
+    // restart with the new speed or direction
+    stop();
+    _runningSpeed = false;
+  }
+}
+
+float AccelStepper::speed()
+{
+  return _speed;
+}
+
+// Uses the position of the last report, 0 once the board completed the move
+long AccelStepper::distanceToGo()
+{
+  if (!isRunning()) {
+    return 0;
+  }
+  return _targetPos - _currentPos;
+}
+
+long AccelStepper::targetPosition()
+{
+  return _targetPos;
+}
+
+long AccelStepper::currentPosition()
+{
+#if defined(VB_FIRMATA_PORT)
+  if (_configured && _deviceNum >= 0) {
+    _currentPos = stepperFeature()->getPosition(_deviceNum) + _offset;
+  }
+#endif
+  return _currentPos;
+}
+
+// The board can only zero its position, others are kept as offset
+void AccelStepper::setCurrentPosition(long position)
+{
+#if defined(VB_FIRMATA_PORT)
+  if (configure()) {
+    stepperFeature()->stop(_deviceNum);
+    stepperFeature()->zero(_deviceNum);
+  }
+#endif
+  _offset = position;
+  _targetPos = _currentPos = position;
+  _speed = 0.0;
+  _runningSpeed = false;
+}
+
+void AccelStepper::runToPosition()
+{
+  while (run())
+    ;
+}
+
+bool AccelStepper::runSpeedToPosition()
+{
+  return run();
+}
+
+void AccelStepper::runToNewPosition(long position)
+{
+  moveTo(position);
+  runToPosition();
+}
+
+// The board decelerates to a stop and reports the completion
+void AccelStepper::stop()
+{
+#if defined(VB_FIRMATA_PORT)
+  if (_configured && _deviceNum >= 0 && isRunning()) {
+    stepperFeature()->stop(_deviceNum);
+  }
+#endif
+  _runningSpeed = false;
+}
+
+void AccelStepper::disableOutputs()
+{
+  _enabled = false;
+#if defined(VB_FIRMATA_PORT)
+  if (_configured && _deviceNum >= 0) {
+    stepperFeature()->enable(_deviceNum, false);
+  }
+#endif
+}
+
+void AccelStepper::enableOutputs()
+{
+  _enabled = true;
+#if defined(VB_FIRMATA_PORT)
+  if (_configured && _deviceNum >= 0) {
+    stepperFeature()->enable(_deviceNum, true);
+  }
+#endif
+}
+
+void AccelStepper::setEnablePin(uint8_t enablePin)
+{
+  if (_configured) {
+    logError("AccelStepper: Enable pin must be set before the first move\n");
+  }
+  _enablePin = enablePin;
+}
+
+void AccelStepper::setPinsInverted(bool directionInvert, bool stepInvert, bool enableInvert)
+{
+  // driver pins: step, direction
+  setPinsInverted(stepInvert, directionInvert, false, false, enableInvert);
+}
+
+void AccelStepper::setPinsInverted(bool pin1Invert, bool pin2Invert, bool pin3Invert, bool pin4Invert, bool enableInvert)
+{
+  if (_configured) {
+    logError("AccelStepper: Pins must be inverted before the first move\n");
+  }
+  _invertPins = (pin1Invert ? 0x01 : 0) | (pin2Invert ? 0x02 : 0) | (pin3Invert ? 0x04 : 0) |
+                (pin4Invert ? 0x08 : 0) | (enableInvert ? 0x10 : 0);
+}
+
+bool AccelStepper::isRunning()
+{
+#if defined(VB_FIRMATA_PORT)
+  return _configured && _deviceNum >= 0 && stepperFeature()->isRunning(_deviceNum);
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,96 @@
+/*
+  AccelStepper.h - Part of the VirtualBoard project
+
+  Stepper motor API compatible with the AccelStepper library by Mike McCauley.
+  The pulses are generated by the board (AccelStepperFirmata), the host only
+  sends target position, speed and acceleration and receives the completion.
+
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef AccelStepper_h
+#define AccelStepper_h
+
+#include <inttypes.h>
+
+class AccelStepper
+{
+  public:
+    typedef enum
+    {
+      FUNCTION  = 0, // not supported
+      DRIVER    = 1, // step and direction pins
+      FULL2WIRE = 2,
+      FULL3WIRE = 3,
+      FULL4WIRE = 4,
+      HALF3WIRE = 6,
+      HALF4WIRE = 8
+    } MotorInterfaceType;
+
+    AccelStepper(uint8_t interface = AccelStepper::FULL4WIRE, uint8_t pin1 = 2, uint8_t pin2 = 3, uint8_t pin3 = 4, uint8_t pin4 = 5, bool enable = true);
+
+    void moveTo(long absolute);
+    void move(long relative);
+    // Return true while the motor is moving, the board does the steps
+    bool run();
+    bool runSpeed();
+    void setMaxSpeed(float speed);
+    float maxSpeed();
+    void setAcceleration(float acceleration);
+    float acceleration();
+    void setSpeed(float speed);
+    float speed();
+    long distanceToGo();
+    long targetPosition();
+    long currentPosition();
+    void setCurrentPosition(long position);
+    void runToPosition();
+    bool runSpeedToPosition();
+    void runToNewPosition(long position);
+    void stop();
+    void disableOutputs();
+    void enableOutputs();
+    void setEnablePin(uint8_t enablePin = 0xff);
+    void setPinsInverted(bool directionInvert = false, bool stepInvert = false, bool enableInvert = false);
+    void setPinsInverted(bool pin1Invert, bool pin2Invert, bool pin3Invert, bool pin4Invert, bool enableInvert);
+    bool isRunning();
+
+  private:
+    // The stepper is configured on the board with the first motion,
+    // after setEnablePin() and setPinsInverted() of setup().
+    bool configure();
+
+    uint8_t _interface;
+    uint8_t _pins[4];
+    uint8_t _enablePin = 0xff;
+    uint8_t _invertPins = 0;
+    bool _enabled;
+    int _deviceNum = -1;
+    bool _configured = false;
+
+    long _targetPos = 0;
+    long _currentPos = 0;
+    long _offset = 0; // position set by setCurrentPosition() at the board's zero
+    float _maxSpeed = 1.0;
+    float _acceleration = 1.0;
+    float _speed = 0.0;
+    bool _runningSpeed = false;
+};
+
+#include "AccelStepper.cpp"
+
+#endif
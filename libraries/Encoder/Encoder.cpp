@@ -0,0 +1,93 @@
+/*
+  Encoder.cpp - Based on the Encoder library for Arduino and Teensy
+  Copyright (c) 2011,2013 PJRC.COM, LLC - Paul Stoffregen <paul@pjrc.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  Modified 2022 for the VirtualBoard project https://github.com/virtual-maker/VirtualBoard
+  Copyright (c) 2022 Immo Wache
+*/
+
+#include "Encoder.h"
+#include <utils/log.h>
+
+#if defined(VB_FIRMATA_PORT)
+// One feature serves all encoder instances
+static CFI_EncoderFeature* encoderFeature()
+{
+  static CFI_EncoderFeature* feature = new CFI_EncoderFeature(GPIO.ClientFirmata);
+  return feature;
+}
+#endif
+
+Encoder::Encoder(uint8_t pin1, uint8_t pin2)
+{
+#if defined(VB_FIRMATA_PORT)
+  // Encoders are usually global objects, constructed before the
+  // Firmata client is started, so the board is set up on first use.
+  _pin1 = pin1;
+  _pin2 = pin2;
+#else
+  (void)pin1;
+  (void)pin2;
+#endif
+}
+
+Encoder::~Encoder()
+{
+#if defined(VB_FIRMATA_PORT)
+  // give the board's encoder back, e.g. for a local object
+  if (_encoderNum >= 0) {
+    encoderFeature()->detach(_encoderNum);
+  }
+#endif
+}
+
+#if defined(VB_FIRMATA_PORT)
+bool Encoder::attach()
+{
+  if (!_attached) {
+    _attached = true;
+    _encoderNum = encoderFeature()->attach(_pin1, _pin2);
+    if (_encoderNum < 0) {
+      logError("Encoder: No free encoder on the board for pins %d and %d\n", _pin1, _pin2);
+    }
+  }
+  return _encoderNum >= 0;
+}
+#endif
+
+int32_t Encoder::read()
+{
+#if defined(VB_FIRMATA_PORT)
+  if (attach()) {
+    _position = encoderFeature()->readPosition(_encoderNum);
+  }
+#endif
+  return _position;
+}
+
+int32_t Encoder::readAndReset()
+{
+  int32_t position = read();
+  write(0);
+  return position;
+}
+
+void Encoder::write(int32_t p)
+{
+#if defined(VB_FIRMATA_PORT)
+  if (attach()) {
+    encoderFeature()->writePosition(_encoderNum, p);
+  }
+#endif
+  _position = p;
+}
@@ -0,0 +1,49 @@
+/*
+  Encoder.h - Based on the Encoder library for Arduino and Teensy
+  Copyright (c) 2011,2013 PJRC.COM, LLC - Paul Stoffregen <paul@pjrc.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  Modified 2022 for the VirtualBoard project https://github.com/virtual-maker/VirtualBoard
+  Copyright (c) 2022 Immo Wache
+*/
+
+#ifndef Encoder_h
+#define Encoder_h
+
+#include <inttypes.h>
+
+class Encoder
+{
+  public:
+    Encoder(uint8_t pin1, uint8_t pin2);
+    ~Encoder();
+    int32_t read();
+    int32_t readAndReset();
+    void write(int32_t p);
+
+  private:
+#if defined(VB_FIRMATA_PORT)
+    // The quadrature edges are counted by the board (FirmataEncoder),
+    // the positions are reported with the sampling interval.
+    bool attach();
+
+    uint8_t _pin1;
+    uint8_t _pin2;
+    bool _attached = false;
+    int _encoderNum = -1;
+#endif
+    int32_t _position = 0;
+};
+
+#include "Encoder.cpp"
+
+#endif
@@ -27,6 +27,7 @@
 #include <cstdio>
 #include <cstring>
 #include <errno.h>
+#include <thread>
 #include <utils/log.h>
 
 EthernetClient::EthernetClient() : _sock(-1)
@@ -109,6 +110,18 @@ int EthernetClient::available()
 	return ethernetWrapper.clientAvailable(_sock);
 }
 
+bool EthernetClient::waitAvailable(unsigned long timeout)
+{
+	unsigned long start = millis();
+	while (available() <= 0) {
+		if (_sock == -1 || millis() - start >= timeout) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
 int EthernetClient::read()
 {
 	uint8_t b;
@@ -116,6 +116,15 @@ public:
 	 * @return number of bytes available.
 	 */
 	virtual int available();
+	/**
+	 * @brief Sleeps until bytes are available or the timeout elapsed.
+	 *
+	 * The wrapper offers no readiness wait, the socket is polled every ms.
+	 *
+	 * @param timeout in ms.
+	 * @return true if bytes are available.
+	 */
+	virtual bool waitAvailable(unsigned long timeout);
 	/**
 	 * @brief Read a byte.
 	 *
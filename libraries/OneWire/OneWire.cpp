@@ -0,0 +1,215 @@
+/*
+  OneWire.cpp - Based on the OneWire library for Arduino and Teensy
+  Copyright (c) 2007, Jim Studt  (original old version - many contributors since)
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  Modified 2022 for the VirtualBoard project https://github.com/virtual-maker/VirtualBoard
+  Copyright (c) 2022 Immo Wache
+*/
+
+#include "OneWire.h"
+#include <utils/log.h>
+
+#if defined(VB_FIRMATA_PORT)
+// One feature serves all buses
+static CFI_OneWireFeature* oneWireFeature()
+{
+  static CFI_OneWireFeature* feature = new CFI_OneWireFeature(GPIO.ClientFirmata);
+  return feature;
+}
+#endif
+
+void OneWire::begin(uint8_t pin)
+{
+  _pin = pin;
+  _power = false;
+  reset_search();
+#if defined(VB_FIRMATA_PORT)
+  _configured = false;
+#endif
+}
+
+#if defined(VB_FIRMATA_PORT)
+// Buses are usually global objects, constructed before the Firmata
+// client is started, so the pin is configured on first use.
+CFI_OneWireFeature* OneWire::feature()
+{
+  if (!_configured) {
+    _configured = true;
+    oneWireFeature()->config(_pin, _power);
+  }
+  return oneWireFeature();
+}
+#endif
+
+uint8_t OneWire::reset(void)
+{
+#if defined(VB_FIRMATA_PORT)
+  feature()->reset(_pin);
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+void OneWire::select(const uint8_t rom[8])
+{
+#if defined(VB_FIRMATA_PORT)
+  feature()->select(_pin, rom);
+#endif
+}
+
+void OneWire::skip(void)
+{
+#if defined(VB_FIRMATA_PORT)
+  feature()->skip(_pin);
+#endif
+}
+
+void OneWire::write(uint8_t v, uint8_t power)
+{
+  write_bytes(&v, 1, power);
+}
+
+// The power setting of the board applies to all following writes,
+// it is kept until depower()
+void OneWire::write_bytes(const uint8_t *buf, uint16_t count, bool power)
+{
+#if defined(VB_FIRMATA_PORT)
+  if (power && !_power) {
+    _power = true;
+    _configured = false;
+  }
+  feature()->write(_pin, buf, count);
+#endif
+}
+
+uint8_t OneWire::read(void)
+{
+  uint8_t value = 0xFF;
+  read_bytes(&value, 1);
+  return value;
+}
+
+void OneWire::read_bytes(uint8_t *buf, uint16_t count)
+{
+#if defined(VB_FIRMATA_PORT)
+  if (feature()->read(_pin, buf, count)) {
+    return;
+  }
+#endif
+  memset(buf, 0xFF, count);
+}
+
+void OneWire::write_bit(uint8_t v)
+{
+  (void)v;
+  logError("OneWire: Single bit write not supported\n");
+}
+
+uint8_t OneWire::read_bit(void)
+{
+  logError("OneWire: Single bit read not supported\n");
+  return 1;
+}
+
+void OneWire::depower(void)
+{
+#if defined(VB_FIRMATA_PORT)
+  if (_power) {
+    _power = false;
+    _configured = false;
+    feature();
+  }
+#endif
+}
+
+void OneWire::reset_search()
+{
+  _searchIndex = -1;
+  _targetFamily = 0;
+}
+
+void OneWire::target_search(uint8_t family_code)
+{
+  _searchIndex = -1;
+  _targetFamily = family_code;
+}
+
+// The board searches the whole bus at once, the addresses are returned
+// one by one from the result. search_mode false finds devices in alarm.
+bool OneWire::search(uint8_t *newAddr, bool search_mode)
+{
+#if defined(VB_FIRMATA_PORT)
+  if (_searchIndex < 0) {
+    _addressCount = feature()->search(_pin, _addresses, ONEWIRE_MAX_DEVICES, !search_mode);
+    _searchIndex = 0;
+  }
+  while (_searchIndex < _addressCount) {
+    const uint8_t *address = _addresses + 8 * _searchIndex++;
+    if (_targetFamily == 0 || address[0] == _targetFamily) {
+      memcpy(newAddr, address, 8);
+      return true;
+    }
+  }
+#else
+  (void)newAddr;
+  (void)search_mode;
+#endif
+  return false;
+}
+
+// Dallas Semiconductor 8 bit CRC, polynomial x^8 + x^5 + x^4 + 1
+uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len)
+{
+  uint8_t crc = 0;
+
+  while (len--) {
+    uint8_t inbyte = *addr++;
+    for (uint8_t i = 8; i; i--) {
+      uint8_t mix = (crc ^ inbyte) & 0x01;
+      crc >>= 1;
+      if (mix) crc ^= 0x8C;
+      inbyte >>= 1;
+    }
+  }
+  return crc;
+}
+
+bool OneWire::check_crc16(const uint8_t* input, uint16_t len, const uint8_t* inverted_crc, uint16_t crc)
+{
+  crc = ~crc16(input, len, crc);
+  return (crc & 0xFF) == inverted_crc[0] && (crc >> 8) == inverted_crc[1];
+}
+
+uint16_t OneWire::crc16(const uint8_t* input, uint16_t len, uint16_t crc)
+{
+  static const uint8_t oddparity[16] =
+    { 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 };
+
+  for (uint16_t i = 0; i < len; i++) {
+    // Even though we're just copying a byte from the input,
+    // we'll be doing 16-bit computation with it.
+    uint16_t cdata = input[i];
+    cdata = (cdata ^ crc) & 0xff;
+    crc >>= 8;
+
+    if (oddparity[cdata & 0x0F] ^ oddparity[cdata >> 4])
+      crc ^= 0xC001;
+
+    cdata <<= 6;
+    crc ^= cdata;
+    cdata <<= 1;
+    crc ^= cdata;
+  }
+  return crc;
+}
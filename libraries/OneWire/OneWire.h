@@ -0,0 +1,72 @@
+/*
+  OneWire.h - Based on the OneWire library for Arduino and Teensy
+  Copyright (c) 2007, Jim Studt  (original old version - many contributors since)
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  Modified 2022 for the VirtualBoard project https://github.com/virtual-maker/VirtualBoard
+  Copyright (c) 2022 Immo Wache
+*/
+
+#ifndef OneWire_h
+#define OneWire_h
+
+#include <inttypes.h>
+
+// The bus timing is done by the board (OneWireFirmata). Commands are
+// collected and sent as one message with the next read or update, so
+// reset(), select() and write() cost no round-trip of their own.
+class OneWire
+{
+  public:
+    OneWire() { }
+    OneWire(uint8_t pin) { begin(pin); }
+    void begin(uint8_t pin);
+
+    // Perform a 1-Wire reset cycle. The board does not report the presence
+    // pulse, so 1 is returned whenever a board is connected.
+    uint8_t reset(void);
+    void select(const uint8_t rom[8]);
+    void skip(void);
+    void write(uint8_t v, uint8_t power = 0);
+    void write_bytes(const uint8_t *buf, uint16_t count, bool power = 0);
+    uint8_t read(void);
+    void read_bytes(uint8_t *buf, uint16_t count);
+    // Single bits are not supported by the Firmata protocol
+    void write_bit(uint8_t v);
+    uint8_t read_bit(void);
+    void depower(void);
+
+    void reset_search();
+    void target_search(uint8_t family_code);
+    bool search(uint8_t *newAddr, bool search_mode = true);
+
+    static uint8_t crc8(const uint8_t *addr, uint8_t len);
+    static bool check_crc16(const uint8_t* input, uint16_t len, const uint8_t* inverted_crc, uint16_t crc = 0);
+    static uint16_t crc16(const uint8_t* input, uint16_t len, uint16_t crc = 0);
+
+  private:
+    uint8_t _pin = 0;
+    bool _power = false;
+#if defined(VB_FIRMATA_PORT)
+    CFI_OneWireFeature* feature();
+
+    bool _configured = false;
+    uint8_t _addresses[ONEWIRE_MAX_DEVICES * 8];
+    uint8_t _addressCount = 0;
+#endif
+    int _searchIndex = -1; // -1 = new search on the board
+    uint8_t _targetFamily = 0;
+};
+
+#include "OneWire.cpp"
+
+#endif
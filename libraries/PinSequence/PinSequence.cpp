@@ -0,0 +1,103 @@
+/*
+  PinSequence.cpp - Part of the VirtualBoard project
+
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "PinSequence.h"
+#include <utils/log.h>
+
+#if defined(VB_FIRMATA_PORT)
+// One feature serves all sequences
+static CFI_SchedulerFeature* schedulerFeature()
+{
+  static CFI_SchedulerFeature* feature = new CFI_SchedulerFeature(GPIO.ClientFirmata);
+  return feature;
+}
+#endif
+
+void PinSequence::clear()
+{
+#if defined(VB_FIRMATA_PORT)
+  _task.clear();
+#endif
+}
+
+void PinSequence::pinMode(uint8_t pin, uint8_t mode)
+{
+#if defined(VB_FIRMATA_PORT)
+  _task.pinMode(pin, mode == INPUT_PULLUP ? CFI_PIN_MODE_PULLUP : mode);
+#endif
+}
+
+void PinSequence::digitalWrite(uint8_t pin, uint8_t value)
+{
+#if defined(VB_FIRMATA_PORT)
+  _task.digitalWrite(pin, value != LOW);
+#endif
+}
+
+void PinSequence::analogWrite(uint8_t pin, int value)
+{
+#if defined(VB_FIRMATA_PORT)
+  _task.analogWrite(pin, value);
+#endif
+}
+
+void PinSequence::delay(unsigned long ms)
+{
+#if defined(VB_FIRMATA_PORT)
+  _task.delay(ms);
+#endif
+}
+
+bool PinSequence::upload()
+{
+  remove();
+#if defined(VB_FIRMATA_PORT)
+  if (_task.overflow()) {
+    logError("PinSequence: Sequence longer than %d bytes\n", CFI_TASK_MAX_SIZE);
+    return false;
+  }
+  _taskId = schedulerFeature()->createTask(_task);
+  return _taskId >= 0;
+#else
+  logError("PinSequence: Needs a Firmata board with scheduler\n");
+  return false;
+#endif
+}
+
+void PinSequence::run(unsigned long delay)
+{
+#if defined(VB_FIRMATA_PORT)
+  if (_taskId >= 0) {
+    schedulerFeature()->scheduleTask(_taskId, delay);
+  }
+#else
+  (void)delay;
+#endif
+}
+
+void PinSequence::remove()
+{
+#if defined(VB_FIRMATA_PORT)
+  if (_taskId >= 0) {
+    schedulerFeature()->deleteTask(_taskId);
+  }
+#endif
+  _taskId = -1;
+}
@@ -0,0 +1,60 @@
+/*
+  PinSequence.h - Part of the VirtualBoard project
+
+  Records a sequence of pin operations with delays, uploads it once to the
+  scheduler of the board (FirmataScheduler) and runs it on demand. The timing
+  of the sequence is done by the board, each run costs one message.
+  The levels set by a run are not known to the host: digitalWrite() of the
+  sketch changes only its own pin, but digitalWritePort() and a bit-banged
+  shiftOut() on the same port overwrite the pins of the sequence.
+
+  Copyright (c) 2022 Immo Wache. All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PinSequence_h
+#define PinSequence_h
+
+#include <inttypes.h>
+
+class PinSequence
+{
+  public:
+    PinSequence() { }
+
+    void clear();
+    void pinMode(uint8_t pin, uint8_t mode);
+    void digitalWrite(uint8_t pin, uint8_t value);
+    void analogWrite(uint8_t pin, int value);
+    // Delays have millisecond resolution on the board
+    void delay(unsigned long ms);
+
+    // Uploads the recorded sequence, returns false if it did not fit
+    bool upload();
+    // Starts the sequence after the given delay in milliseconds
+    void run(unsigned long delay = 0);
+    void remove();
+
+  private:
+#if defined(VB_FIRMATA_PORT)
+    CFI_SchedulerTask _task;
+#endif
+    int _taskId = -1;
+};
+
+#include "PinSequence.cpp"
+
+#endif
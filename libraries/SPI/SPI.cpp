@@ -31,17 +31,25 @@ SPIClass SPI = SPIClass();
 
 SPIClass::SPIClass()
 {
+}
+
 #if defined(VB_FIRMATA_PORT)
-  _spi = new CFI_SPIFeature(GPIO.ClientFirmata);
-#endif
+// the SPI feature is registered with the board only if the sketch uses the bus
+CFI_SPIFeature* SPIClass::spi()
+{
+  if (_spi == NULL) {
+    _spi = new CFI_SPIFeature(GPIO.ClientFirmata);
+  }
+  return _spi;
 }
+#endif
 
 void SPIClass::begin(int busNo)
 {
 #if defined(VB_FIRMATA_PORT)
   _lastCsPin = 255;
   byte channel = 0;
-  _spi->begin(channel);
+  spi()->begin(channel);
 #elif defined(VM_DISABLE_SPI)
   logError("Can't open SPI device\n");
 #else
@@ -53,7 +61,9 @@ void SPIClass::end()
 {
 #if defined(VB_FIRMATA_PORT)
   byte channel = 0;
-  _spi->end(channel);
+  if (_spi != NULL) {
+    _spi->end(channel);
+  }
 #elif defined(VM_DISABLE_SPI)
   logError("Can't close SPI device\n");
 #else
@@ -98,7 +108,7 @@ void SPIClass::transfer(void* tbuf, void* rbuf, uint32_t len)
 	byte channel = 0;
 	byte requestId = 0;
 	bool deselectCsPin = true;
-	_spi->transfer(deviceId, channel, requestId, deselectCsPin, (byte*)tbuf, (byte*)rbuf, len);
+	spi()->transfer(deviceId, channel, requestId, deselectCsPin, (byte*)tbuf, (byte*)rbuf, len);
 #elif !defined(VM_DISABLE_SPI)
   spiWrapper.transfer((const unsigned char*)tbuf, (const unsigned char*)rbuf, len);
 #endif
@@ -124,7 +134,7 @@ void SPIClass::beginTransaction(SPISettings settings, uint8_t csPinOptions, uint
   _lastDataMode = settings.dmode;
   _lastCsPinOptions = csPinOptions;
   _lastCsPin = csPin;
-  _spi->deviceConfig(deviceId, channel, settings.dmode, settings.border, settings.clock, csPinOptions, csPin);
+  spi()->deviceConfig(deviceId, channel, settings.dmode, settings.border, settings.clock, csPinOptions, csPin);
 #elif !defined(VM_DISABLE_SPI)
   spiWrapper.beginTransaction(settings.clock, settings.border, settings.dmode);
 #endif
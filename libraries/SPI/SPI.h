@@ -191,7 +191,8 @@ class SPIClass
   private:
     void init();
 #if defined(VB_FIRMATA_PORT)
-    CFI_SPIFeature* _spi = NULL;
+    CFI_SPIFeature* _spi = NULL; // created by SPI.begin() or the first transfer
+    CFI_SPIFeature* spi();
     uint32_t _lastClock = 0;
     uint8_t _lastBitOrder = 0;
     uint8_t _lastDataMode = 0;
@@ -48,6 +48,7 @@ SoftwareSerial::SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inv
 void SoftwareSerial::begin(unsigned long baud)
 {
   _written = false;
+  clearReceived();
 
   _serialInternal.setPort(_deviceName);
   _serialInternal.setBaudrate(baud);
@@ -60,34 +61,7 @@ void SoftwareSerial::end()
   // wait for transmission of outgoing data
   flush();
   _serialInternal.close();
-}
-
-int SoftwareSerial::available(void)
-{
-  return _serialInternal.available();
-}
-
-int SoftwareSerial::peek(void)
-{
-  // ToDo: return _serialInternal.peek();
-  return -1;
-}
-
-int SoftwareSerial::read(void)
-{
-  uint8_t b;
-  if (read((unsigned char*)&b, 1) >= 0) {
-    // read worked
-    return b;
-  } else {
-    // No data available
-    return -1;
-  }
-}
-
-int SoftwareSerial::read(uint8_t *buf, size_t bytes)
-{
-  return _serialInternal.read(buf, bytes);
+  clearReceived();
 }
 
 int SoftwareSerial::availableForWrite(void)
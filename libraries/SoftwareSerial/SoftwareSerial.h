@@ -27,17 +27,19 @@
 #ifndef SoftwareSerial_h
 #define SoftwareSerial_h
 
-#include <Stream.h>
-#include "serial/serial.h"
+#include <SerialStream.h>
 
 #if !defined(VM_SWSERIAL_PORTNAME)
 #define VM_SWSERIAL_PORTNAME "NULL"
 #endif
 
-class SoftwareSerial : public Stream
+#if !defined(_SS_MAX_RX_BUFF)
+#define _SS_MAX_RX_BUFF 1024 // received bytes fetched from the driver with one read
+#endif
+
+class SoftwareSerial : public SerialStream<_SS_MAX_RX_BUFF>
 {
   private:
-    serial::SerialClass _serialInternal;
     static SoftwareSerial *active_object;
 
   protected:
@@ -49,10 +51,6 @@ class SoftwareSerial : public Stream
     SoftwareSerial(uint8_t receivePin, uint8_t transmitPin, bool inverse_logic = false);
     void begin(unsigned long baud);
     void end();
-    virtual int available(void);
-    virtual int peek(void);
-    virtual int read(void);
-    virtual int read(uint8_t *buf, size_t bytes);
     virtual int availableForWrite(void);
     virtual void flush(void);
     virtual size_t write(uint8_t);
@@ -51,9 +51,6 @@ void (*TwoWire::user_onReceive)(int);
 // Constructors ////////////////////////////////////////////////////////////////
 
 TwoWire::TwoWire() {
-#if defined(VB_FIRMATA_PORT)
-  _i2c = new CFI_I2CFeature(GPIO.ClientFirmata);
-#endif
 }
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -65,7 +62,7 @@ void TwoWire::begin(void) {
   txBufferIndex = 0;
   txBufferLength = 0;
 #if defined(VB_FIRMATA_PORT)
-  _i2c->config(0);
+  i2c()->config(0);
 #elif defined(VM_DISABLE_TWI)
   logError("Can't open TWI device\n");
 #else
@@ -117,7 +114,7 @@ uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint32_t iaddres
     logError("TWI requestFrom isize of iaddress > 1 not supported\n");
     return 0;
   }
-  read = _i2c->request(txAddress,
+  read = i2c()->request(txAddress,
                                sendStop ? CFI_I2C_STOP_TX : CFI_I2C_RESTART_TX,
                                CFI_I2C_READ, txBuffer, 0, rxBuffer, quantity,
                                isize ? (uint8_t)iaddress : CFI_I2C_REGISTER_NOT_SPECIFIED);
@@ -202,7 +199,7 @@ void TwoWire::beginTransmission(int address) {
 uint8_t TwoWire::endTransmission(uint8_t sendStop) {
   uint8_t ret = 0;
 #if defined(VB_FIRMATA_PORT)
-  ret = _i2c->request(txAddress, sendStop ? CFI_I2C_STOP_TX : CFI_I2C_RESTART_TX,
+  ret = i2c()->request(txAddress, sendStop ? CFI_I2C_STOP_TX : CFI_I2C_RESTART_TX,
       CFI_I2C_WRITE, txBuffer, txBufferLength, rxBuffer, 0);
 #elif defined(VM_DISABLE_TWI)
   return 4; // other error
@@ -369,6 +366,16 @@ void TwoWire::onRequest(void(*function)(void)) {
   user_onRequest = function;
 }
 
+#if defined(VB_FIRMATA_PORT)
+// the I2C feature is registered with the board only if the sketch uses the bus
+CFI_I2CFeature* TwoWire::i2c() {
+  if (_i2c == NULL) {
+    _i2c = new CFI_I2CFeature(GPIO.ClientFirmata);
+  }
+  return _i2c;
+}
+#endif
+
 // Preinstantiate Objects //////////////////////////////////////////////////////
 
 TwoWire Wire = TwoWire();
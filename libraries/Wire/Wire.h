@@ -101,7 +101,8 @@ class TwoWire : public Stream
 
 private:
 #if defined(VB_FIRMATA_PORT)
-    CFI_I2CFeature* _i2c = NULL;
+    CFI_I2CFeature* _i2c = NULL; // created by the first transfer
+    CFI_I2CFeature* i2c();
 #endif
 };
 